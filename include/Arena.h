@@ -0,0 +1,111 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// A region allocator that a calendar and everything in it can come from
+
+#include <stddef.h>
+
+/**
+ * One chunk of memory that allocations are carved out of. Blocks are chained together and never moved
+ **/
+typedef struct arenaBlock {
+	struct arenaBlock* next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+} ArenaBlock;
+
+/**
+ * Data that was allocated outside of the arena but handed to something that lives in it.
+ * It is deleted with its own delete function when the arena is freed, once, however many times it was adopted
+ **/
+typedef struct arenaForeign {
+	void* data;
+	void (*deleteData)(void* toBeDeleted);
+	size_t count; // Number of times it was adopted and not released yet. The record goes when this gets to 0
+	struct arenaForeign* next; // Next in the same bucket
+} ArenaForeign;
+
+/**
+ * A region allocator. Everything allocated from it is released at once by freeArena
+ **/
+typedef struct arena {
+	//Most recent block first
+	ArenaBlock* blocks;
+
+	//Every block again, in order of address, so arenaOwns can binary search them
+	ArenaBlock** sorted;
+	size_t blockCount;
+	size_t sortedCapacity;
+
+	//Fixed size chunks (list nodes) that were handed back and can be reused
+	void* recycled;
+
+	//Data the arena does not own but has to delete, hashed by address so it can be released in O(1)
+	ArenaForeign** foreign;
+	size_t foreignBuckets;
+	size_t foreignCount;
+} Arena;
+
+/** Creates an empty arena. Memory is only reserved once something is allocated
+ *@return the arena, or NULL if it could not be allocated
+ **/
+Arena* newArena();
+
+/** Deletes all of the adopted data and releases every block of the arena, then the arena itself
+ *@post every pointer allocated from the arena is invalid
+ *@param arena - the arena to free. May be NULL
+ **/
+void freeArena(Arena* arena);
+
+/** Allocates memory from the arena. Falls back to malloc when there is no arena so callers do not have to care
+ *@return a pointer to the memory, aligned for any type, or NULL if it could not be allocated
+ *@param arena - the arena to allocate from, or NULL to use malloc
+ *@param size - the number of bytes needed
+ **/
+void* arenaAlloc(Arena* arena, size_t size);
+
+/** Same as arenaAlloc but the memory is zeroed (falls back to calloc)
+ **/
+void* arenaCalloc(Arena* arena, size_t size);
+
+/** Allocates a fixed size chunk, reusing one that was handed back with arenaRecycle if there is one.
+ * Every chunk handed back to an arena must have the same size
+ **/
+void* arenaAllocRecycled(Arena* arena, size_t size);
+
+/** Hands a chunk from arenaAllocRecycled back to the arena so it can be reused
+ **/
+void arenaRecycle(Arena* arena, void* chunk);
+
+/** Returns the number of bytes handed out by the arena (including alignment padding), and optionally the number
+ * of bytes it has reserved from malloc for its blocks
+ *@param arena - the arena to measure. May be NULL
+ *@param reserved - where to store the reserved bytes, or NULL
+ **/
+size_t arenaBytesUsed(const Arena* arena, size_t* reserved);
+
+/** Returns 1 if the pointer was allocated from the arena, 0 otherwise (including when there is no arena).
+ * Takes O(log blocks), and O(1) for memory from the most recent block
+ **/
+int arenaOwns(const Arena* arena, const void* p);
+
+/** Makes the arena responsible for deleting data it did not allocate. Data that is adopted again is counted
+ * rather than recorded twice, and the arena keeps it until it has been released as many times
+ *@param arena - the arena that takes the data over
+ *@param data - the data to delete when the arena is freed
+ *@param deleteData - the function that deletes it
+ **/
+void arenaAdopt(Arena* arena, void* data, void (*deleteData)(void* toBeDeleted));
+
+/** Takes back one adoption of the data in O(1). The arena no longer deletes it once every adoption has been taken back,
+ * and from then on the caller owns it. Does nothing to data that was never adopted
+ **/
+void arenaRelease(Arena* arena, void* data);
+
+/** Deletes data that may or may not belong to the arena. Data from the arena is left for freeArena,
+ * anything else is deleted with deleteData
+ **/
+void arenaDelete(Arena* arena, void* data, void (*deleteData)(void* toBeDeleted));
+
+#endif
@@ -21,18 +21,54 @@ typedef struct dt {
 	bool	UTC;
 } DateTime;
 
+//The iCalendar (RFC 5545) properties the parser knows by name.  Anything else, such as X- properties, is PROP_OTHER
+typedef enum propKind {PROP_OTHER,
+	PROP_BEGIN, PROP_END, PROP_CALSCALE, PROP_METHOD, PROP_PRODID, PROP_VERSION, PROP_ATTACH, PROP_CATEGORIES, PROP_CLASS,
+	PROP_COMMENT, PROP_DESCRIPTION, PROP_GEO, PROP_LOCATION, PROP_PERCENT_COMPLETE, PROP_PRIORITY, PROP_RESOURCES, PROP_STATUS,
+	PROP_SUMMARY, PROP_COMPLETED, PROP_DTEND, PROP_DUE, PROP_DTSTART, PROP_DURATION, PROP_FREEBUSY, PROP_TRANSP, PROP_TZID,
+	PROP_TZNAME, PROP_TZOFFSETFROM, PROP_TZOFFSETTO, PROP_TZURL, PROP_ATTENDEE, PROP_CONTACT, PROP_ORGANIZER,
+	PROP_RECURRENCE_ID, PROP_RELATED_TO, PROP_URL, PROP_UID, PROP_EXDATE, PROP_RDATE, PROP_RRULE, PROP_ACTION, PROP_REPEAT,
+	PROP_TRIGGER, PROP_CREATED, PROP_DTSTAMP, PROP_LAST_MODIFIED, PROP_SEQUENCE, PROP_REQUEST_STATUS,
+	PROP_KIND_COUNT} PropertyKind;
+
+//A parameter of a property, such as TZID=America/Toronto in DTSTART;TZID=America/Toronto:20151002T100000.
+//Its name and value are not copied out of the property's propDescr, they are found by where they are in it
+typedef struct propParam {
+	//Where the parameter name starts in propDescr, and how long it is
+	unsigned int	nameOffset;
+	unsigned int	nameLength;
+	//Where the value starts in propDescr, and how long it is.  A value in quotes does not include the quotes
+	unsigned int	valueOffset;
+	unsigned int	valueLength;
+} PropertyParameter;
+
+//The parameters of a property and where its value starts.  Kept after the property's description, in the same
+//allocation, and only there if the property's name was followed by ';'
+typedef struct propParams {
+	//Where the value starts in propDescr, after the parameters.  0 if there are none
+	unsigned int	valueOffset;
+	//How many parameters there are.  0 if what came after the ';' could not be read as parameters
+	unsigned int	count;
+	PropertyParameter	params[];
+} PropertyParameters;
+
 //Represents a generic iCalendar property
 typedef struct prop {
-	//Property name.  We will assume that the property name, even if malformed, does not exceed 200 bytes
-	char 	propName[200];
-	//Property description.  We use a C99 flexible array member, which we will discuss in class.
+	//Property name.  Usually interned, so properties with the same name share it.  It must not be changed or freed
+	const char* 	propName;
+	//Which property this is, worked out from the name (ignoring case) when the property was created
+	PropertyKind	kind;
+	//Where the property's PropertyParameters start, in bytes from the start of the property.  0 if it has none.
+	//Read them with getPropertyValue and getPropertyParameter
+	unsigned int	paramsOffset;
+	//Property description: the parameters and the value as they were written.  We use a C99 flexible array member, which we will discuss in class.
 	char	propDescr[];
 } Property;
 
 //Represents an iCalendar alarm component
 typedef struct alarm {
-	//Alarm action.  We will assume that the action, even if malformed, does not exceed 200 bytes
-    char    action[200];
+	//Alarm action.  NULL until it is set.  Read it with getAlarmAction and write it with setAlarmAction
+    char*   action;
 	//Alarm trigger.
     char*   trigger;
 	//Additional alarm properties.  All objects in the list will be of type Property.  It may be empty.
@@ -41,14 +77,16 @@ typedef struct alarm {
 
 //Represents an iCalendar event component
 typedef struct evt {
-	//Event user ID.  We will assume that the UserID, even if malformed, does not exceed 1000 bytes
-	char 		UID[1000];
+	//Event user ID.  NULL until it is set.  Read it with getEventUID and write it with setEventUID
+	char* 		UID;
 	//Event creation date-time.
     DateTime 	creationDateTime;
 	//Additional event properties.  All objects in the list will be of type Property.  It may be empty.
 	List 	    properties;
 	//List of alarms associated with the event.  All objects in the list will be of type Alarm.  It may be empty.
     List        alarms;
+	//Set on an event from createCalendarLazy.  Its properties and alarms stay empty until loadEvent decodes them.  NULL otherwise
+    struct eventLoader* loader;
 
 } Event;
 
@@ -57,13 +95,16 @@ typedef struct evt {
 typedef struct ical {
 	//iCalendar version
 	float 	version;
-	//Product ID.  We will assume that the UserID, even if malformed, does not exceed 1000 bytes
-	char 	prodID[1000];
+	//Product ID.  NULL until it is set.  Read it with getCalendarProdID and write it with setCalendarProdID
+	char* 	prodID;
 
 	List events;
 
     List properties;
 
+	//Arena that the calendar and everything in it were allocated from. NULL if they were allocated one by one
+	Arena* arena;
+
 } Calendar;
 
 
@@ -84,6 +125,96 @@ typedef struct ical {
 ICalErrorCode createCalendar(char* fileName, Calendar** obj);
 
 
+/** Function to create a Calendar object by memory mapping an iCalendar file and tokenizing it in place.
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendar.  Lines are only copied out of the mapping when they have to be unfolded
+ *@return the error code indicating success or the error encountered when parsing the calendar
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarMapped(char* fileName, Calendar** obj);
+
+
+/** Function to create a Calendar object that only has the properties with the given names.  Lines of other properties
+ * are skipped by the tokenizer without being copied, which suits jobs that only look at a few properties
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendar, except that the calendar, its events and its alarms only have the named properties.
+        BEGIN, END, VERSION, PRODID, UID, DTSTAMP, ACTION and TRIGGER are always kept.  Properties that were
+        skipped are not validated
+ *@return the error code indicating success or the error encountered when parsing the calendar. OTHER_ERROR if
+        count is negative or propertyNames is NULL when count is not 0
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+ *@param propertyNames - the names of the properties to keep.  Case does not matter
+ *@param count - the number of names
+**/
+ICalErrorCode createCalendarWithProperties(char* fileName, Calendar** obj, char* const propertyNames[], int count);
+
+
+/** Function to create a Calendar object whose events are only decoded when they are used.
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendar, except that only the structure of the file is checked up front: every line,
+        the nesting of the calendar and its events, and the UID and DTSTAMP of each event, which are set.
+        The calendar keeps the file and each event remembers where its lines are.  Its properties and alarms
+        are decoded from them by loadEvent.  validateCalendar, printCalendar, writeCalendar and the other functions
+        that read a whole calendar call it for every event; code that reads the lists of an event directly has to
+        call it first.  Use loadEvent or validateCalendar to find out whether the rest of an event is valid
+ *@return the error code indicating success or the error encountered when checking the structure of the calendar
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarLazy(char* fileName, Calendar** obj);
+
+
+/** Function to decode the properties and alarms of an event from createCalendarLazy if that has not happened yet.
+ *@pre Event object exists and is not null
+ *@post The event's lists are filled in.  Does nothing to an event that was not parsed lazily or that has already
+        been decoded.  Threads reading the same calendar can call it at the same time; the event is decoded once
+ *@return the error that decoding the event gave, the same one createCalendar would have returned for it, or OK
+ *@param event - a pointer to an Event struct
+**/
+ICalErrorCode loadEvent(Event* event);
+
+
+/** Function to create a Calendar object from iCalendar text that is already in memory, such as the body of a request.
+ *@pre Buffer is not NULL unless length is 0.  It does not have to be null terminated
+ *@post Same as createCalendar.  The calendar does not keep any pointers into the buffer
+ *@return the error code indicating success or the error encountered when parsing the calendar.  The same code
+        createCalendar returns for a file with these contents
+ *@param buffer - the iCalendar text
+ *@param length - the number of bytes in the buffer
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarFromBuffer(const char* buffer, size_t length, Calendar** obj);
+
+
+/** Functions to create a Calendar object from a file that is already open, or from a pipe or socket.
+ * Everything from the current position to the end is read and parsed like createCalendarFromBuffer
+ *@pre The descriptor or stream is open for reading
+ *@post Same as createCalendar.  The descriptor or stream is read to the end but not closed
+ *@return the error code indicating success or the error encountered when parsing the calendar.  INV_FILE if it could not be read
+ *@param fd or file - where to read the iCalendar text from
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarFromFd(int fd, Calendar** obj);
+ICalErrorCode createCalendarFromFile(FILE* file, Calendar** obj);
+
+
+/** Function to create a Calendar object from a snapshot saved by writeCalendarSnapshot.
+ *@pre File name cannot be an empty string or NULL.  File represented by this name must exist and must be readable.
+ *@post Same as createCalendar, except that nothing is parsed or validated.  The snapshot is read in one go and
+        the calendar is filled straight from its tables.  A snapshot written by a different format version
+        or on a machine with a different byte order is rejected
+ *@return OK, or INV_FILE if the file cannot be read or is not a snapshot
+ *@param fileName - a string containing the name of the snapshot
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarFromSnapshot(char* fileName, Calendar** obj);
+
+
 /** Function to delete all calendar content and free all the memory.
  *@pre Calendar object exists, is not null, and has not been freed
  *@post Calendar object had been freed
@@ -113,19 +244,106 @@ char* printError(ICalErrorCode err);
 /** Function to writing a Calendar object into a file in iCalendar format.
  *@pre Calendar object exists, is not null, and is valid
  *@post Calendar has not been modified in any way, and a file representing the
-        Calendar contents in iCalendar format has been created
+        Calendar contents in iCalendar format has been created.  The file is replaced atomically like writeCalendars,
+        so it is never left half written
  *@return the error code indicating success or the error encountered when parsing the calendar
  *@param obj - a pointer to a Calendar struct
  **/
 ICalErrorCode writeCalendar(char* fileName, const Calendar* obj);
 
 
+/** Function to write a group of Calendar objects into their files in iCalendar format.
+ *@pre Calendar objects exist, are not null, and are valid
+ *@post Each calendar is written to a temp file next to its file, the temp files are synced to disk together
+        and then renamed over the files.  A file that already existed keeps its permissions.  A reader of a file
+        only ever sees the old calendar or the whole new one, but the group as a whole is not atomic: the renames
+        happen one at a time in the order given, so if one fails the files before it already hold their new
+        calendars and the rest still hold their old ones.  If anything fails before the renames, including
+        validating any one of the calendars, no file is touched.  No temp file is ever left behind
+ *@return the error code indicating success or the first error encountered.  WRITE_ERROR from a failed rename
+          is only returned once every earlier file has been replaced
+ *@param fileNames - the file for each calendar
+ *@param objs - the calendars
+ *@param count - how many calendars there are
+ **/
+ICalErrorCode writeCalendars(char* fileNames[], const Calendar* objs[], int count);
+
+
+/** Function to save a Calendar object as a binary snapshot that createCalendarFromSnapshot can load quickly.
+ *@pre Calendar object exists, is not null, and is valid
+ *@post Calendar has not been modified in any way.  The snapshot replaces the file atomically like writeCalendar
+ *@return the error code indicating success or the error encountered when validating or writing the calendar
+ *@param fileName - the file to save the snapshot in
+ *@param obj - a pointer to a Calendar struct
+ **/
+ICalErrorCode writeCalendarSnapshot(char* fileName, const Calendar* obj);
+
+
 /** Function to validating an existing a Calendar object
  *@pre Calendar object exists and is not null
- *@post Calendar has not been modified in any way
+ *@post Calendar has not been modified in any way, except that events from createCalendarLazy are decoded
  *@return the error code indicating success or the error encountered when validating the calendar
  *@param obj - a pointer to a Calendar struct
  **/
 ICalErrorCode validateCalendar(const Calendar* obj);
 
+
+/** Functions to read the variable length fields of a calendar, event and alarm.
+ *@return the field, or an empty string if it was never set.  The string belongs to the object
+ *@param obj - the object to read the field of
+ **/
+const char* getCalendarProdID(const Calendar* obj);
+const char* getEventUID(const Event* event);
+const char* getAlarmAction(const Alarm* alarm);
+
+/** Functions to read the value of a property and its parameters, which were picked out of the line when it was read.
+ * getPropertyParameter finds a parameter by name, ignoring case, and sets length to the length of its value.
+ * getPropertyParameterCount returns how many parameters there are
+ *@return the value, which is not null terminated for a parameter.  NULL if the property has no such parameter
+ *@param p - the property
+ **/
+const char* getPropertyValue(const Property* p);
+const char* getPropertyParameter(const Property* p, const char* name, size_t* length);
+unsigned int getPropertyParameterCount(const Property* p);
+
+
+/** Functions to set the variable length fields of a calendar, event and alarm.
+ *@pre The object exists and is not null
+ *@post The field holds a copy of the string, taken from the object's arena if it has one.  The old value is freed
+ *@param obj - the object to set the field of
+ *@param value - the new value.  Can be any length
+ **/
+void setCalendarProdID(Calendar* obj, const char* prodID);
+void setEventUID(Event* event, const char* UID);
+void setAlarmAction(Alarm* alarm, const char* action);
+
+
+/** Functions to find, add and delete the events of a calendar.
+ *@pre Calendar object exists and is not null
+ *@post The first lookup by UID indexes the calendar's events. From then on the events list keeps the index
+        up to date, so finding an event by UID or by position takes constant time
+ *@param obj - a pointer to a Calendar struct
+ **/
+Event* getEventAt(const Calendar* obj, int position); // NULL if there are not that many events
+Event* findEventByUID(Calendar* obj, const char* UID); // The first event added with the UID, or NULL
+void addEvent(Calendar* obj, Event* event); // The calendar owns the event from now on
+int deleteEventByUID(Calendar* obj, const char* UID); // Returns 1 if an event was deleted
+void changeEventUID(Calendar* obj, Event* event, const char* UID); // Use instead of setEventUID on an event in the calendar
+
+
+/** Function to export every component of a calendar, with all of its properties and alarms, in one call.
+ * The buffer is built in one pass over the calendar. Each record is on a line of its own and every string in it
+ * is prefixed by its length in bytes, so it can be sliced out even if it holds new lines:
+ *   <number of events>
+ *   E <properties> <alarms> <length>:<UID> <length>:<DTSTAMP> <length>:<SUMMARY or empty>   for each event, followed by
+ *   P <length>:<property as printCalendar prints it>                                      for each of its properties and
+ *   A <properties> <length>:<ACTION> <length>:<TRIGGER>                                   for each of its alarms,
+ *                                                                                         followed by its own P records
+ *@pre Calendar object exists and is not null
+ *@post Calendar has not been modified in any way
+ *@return the buffer, which must be freed by the caller, or NULL if it ran out of memory
+ *@param obj - a pointer to a Calendar struct
+ **/
+char* exportCalendarComponents(const Calendar* obj);
+
 #endif
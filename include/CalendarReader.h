@@ -0,0 +1,80 @@
+#ifndef CALENDAR_READER_H
+#define CALENDAR_READER_H
+
+// Reads iCalendar text a component at a time, so a calendar never has to be in memory all at once to be checked
+
+#include <sys/types.h>
+#include "CalendarParser.h"
+
+#define CALENDAR_READER_BUFFER_SIZE (64 * 1024) // Bytes held by a reader. No line, counting its continuations, can be longer
+
+/**
+ * Where a reader gets its input from. Works like read()
+ *@return the number of bytes put into data, 0 at the end of the input, or -1 if it could not be read
+ **/
+typedef ssize_t (*CalendarSource)(void* context, char* data, size_t length);
+
+/**
+ * What a reader calls as it goes. Any of them can be NULL. Each returns 0 to keep reading, anything else to stop.
+ * The properties, events and alarms handed over are freed once the event they are in is done with, so anything
+ * that has to be kept must be copied
+ **/
+typedef struct calendarHandler {
+	//Called for each property of the calendar itself as it is read, VERSION and PRODID included
+	int (*calendarProperty)(void* context, const Property* p);
+
+	//Called once a whole event has been read and checked, before its properties and alarms are handed over
+	int (*eventStart)(void* context, const Event* event);
+	int (*eventProperty)(void* context, const Event* event, const Property* p);
+	int (*alarm)(void* context, const Event* event, const Alarm* alarm);
+	//Called after the last property and alarm of the event. The event is freed when this returns
+	int (*eventEnd)(void* context, const Event* event);
+
+	//Handed to every callback
+	void* context;
+} CalendarHandler;
+
+/**
+ * A calendar that is being read. Memory use does not depend on the size of the input, only on the
+ * largest event in it
+ **/
+typedef struct calendarReader {
+	CalendarSource source;
+	void* context;
+	//What context points to for a reader started by initializeFdReader
+	int fd;
+	char buffer[CALENDAR_READER_BUFFER_SIZE];
+	//Where the input that has not been handled yet starts and ends in the buffer
+	size_t start;
+	size_t end;
+
+	//Set once the source has nothing more to give
+	int finished;
+	//Set if the source failed. readCalendar returns INV_FILE
+	int failed;
+} CalendarReader;
+
+/** Functions to start a reader that reads from a source, a FILE* or a file descriptor. Nothing is read yet
+ *@post The file is not closed by the reader
+ *@param reader - the reader to start
+ **/
+void initializeCalendarReader(CalendarReader* reader, CalendarSource source, void* context);
+void initializeFileReader(CalendarReader* reader, FILE* file);
+void initializeFdReader(CalendarReader* reader, int fd);
+
+/** Reads a calendar to the end of the input, calling the handler for each calendar property and each event.
+ * Only one event is held at a time. Everything createCalendar checks is checked, but as soon as it is read,
+ * so the error returned is the first one in the input and the callbacks for everything before it have been made
+ *@return OK if the input is a valid calendar. The error createCalendar would find otherwise, INV_FILE if a line
+ *        does not fit in the buffer or the source fails, or OTHER_ERROR if a callback asked to stop
+ *@param handler - the callbacks to make
+ **/
+ICalErrorCode readCalendar(CalendarReader* reader, const CalendarHandler* handler);
+
+/** Reads an iCalendar file like readCalendar
+ *@pre File name must have the .ics extension
+ *@return INV_FILE if the file cannot be opened, otherwise the same as readCalendar
+ **/
+ICalErrorCode readCalendarFile(char* fileName, const CalendarHandler* handler);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef CALENDAR_WRITER_H
+#define CALENDAR_WRITER_H
+
+// Writes iCalendar text a line at a time, so a calendar never has to be in memory all at once to be exported
+
+#include "CalendarParser.h"
+
+#define CALENDAR_WRITER_BUFFER_SIZE (16 * 1024) // Bytes held by a writer before they are handed to its sink
+#define CALENDAR_LINE_OCTETS 75 // Longest line RFC 5545 allows, not counting the CRLF
+
+/**
+ * Where a writer sends its output. Gets called with whole buffers, not single lines
+ *@return 0 if all of the data was written, anything else if it could not be
+ **/
+typedef int (*CalendarSink)(void* context, const char* data, size_t length);
+
+/**
+ * A calendar that is being written. Lines end in CRLF and are folded so that none is longer than
+ * CALENDAR_LINE_OCTETS, without ever splitting a UTF-8 character. Memory use does not depend on what is written
+ **/
+typedef struct calendarWriter {
+	CalendarSink sink;
+	void* context;
+	//What context points to for a writer started by initializeFdWriter
+	int fd;
+	char buffer[CALENDAR_WRITER_BUFFER_SIZE];
+	size_t buffered;
+
+	//Octets on the line being written so far
+	size_t column;
+	//Continuation bytes still to come for the UTF-8 character being written
+	int pending;
+
+	//Set once the sink fails. Everything written after that is dropped and finishCalendarWriter returns WRITE_ERROR
+	int failed;
+} CalendarWriter;
+
+/** Functions to start a writer that writes to a sink, a FILE* or a file descriptor. Nothing is written yet
+ *@post The file is not closed by the writer
+ *@param writer - the writer to start
+ **/
+void initializeCalendarWriter(CalendarWriter* writer, CalendarSink sink, void* context);
+void initializeFileWriter(CalendarWriter* writer, FILE* file);
+void initializeFdWriter(CalendarWriter* writer, int fd);
+
+/** Writes a content line, folding it if it is too long
+ *@param separator - what goes between the name and the value, ":" or ";"
+ **/
+void writeCalendarLine(CalendarWriter* writer, const char* name, const char* separator, const char* value);
+
+/** Writes a property, or every property in a list, as content lines
+ **/
+void writeCalendarProperty(CalendarWriter* writer, const Property* p);
+void writeCalendarProperties(CalendarWriter* writer, List props);
+
+/** Writes BEGIN:VCALENDAR and the required calendar properties. Properties of the calendar itself
+ * should be written next, before the first event
+ **/
+void beginCalendar(CalendarWriter* writer, const char* prodID, float version);
+
+/** Writes one event with its alarms and properties. The event can be thrown away as soon as this returns,
+ * so events can be written one at a time without building the whole calendar
+ *@return OTHER_ERROR if an alarm has no action or trigger, otherwise OK
+ **/
+ICalErrorCode writeCalendarEvent(CalendarWriter* writer, const Event* event);
+
+/** Writes END:VCALENDAR
+ **/
+void endCalendar(CalendarWriter* writer);
+
+/** Writes a whole calendar: its required properties, its other properties and then its events
+ *@pre The calendar is valid
+ *@return the error code of the first thing that went wrong, or OK
+ **/
+ICalErrorCode writeWholeCalendar(CalendarWriter* writer, const Calendar* obj);
+
+/** Hands everything still buffered to the sink. The writer can keep being used afterwards
+ *@return WRITE_ERROR if the sink failed at any point, otherwise OK
+ **/
+ICalErrorCode finishCalendarWriter(CalendarWriter* writer);
+
+#endif
@@ -2,6 +2,8 @@
 char* printEventListFunction(void *toBePrinted);
 // Compare function for event list
 int compareEventListFunction(const void *first, const void *second);
+// Compare function for a list of events sorted by DTSTAMP
+int compareEventCreationTimes(const void *first, const void *second);
 // Delete function for event list
 void deleteEventListFunction(void *toBeDeleted);
 // Print function for property list
@@ -17,52 +19,130 @@ int compareAlarmListFunction(const void *first, const void *second);
 // Delete functino for alarm list
 void deleteAlarmListFunction(void *toBeDeleted);
 int match(const char* string, char* pattern); // Matches a given string against aregex expression
+struct regexCacheEntry* getCompiledRegex(const char* pattern); // Returns the compiled regex for a pattern, compiling it once per process
+void clearRegexCache(); // Frees all of the compiled regular expressions used by match
+unsigned int hashPropertyName(const char* name, size_t length); // Hashes a property name ignoring case, into the perfect hash of known names
+PropertyKind getPropertyKind(const char* name, size_t length); // Returns the kind of a property name, or PROP_OTHER if it is not a known one
+const char* getPropertyKindName(PropertyKind kind); // Returns the usual spelling of a kind of property
+const char* internPropertyName(const char* name, size_t length, PropertyKind* kind); // Returns the shared copy of a property name and sets its kind
+void clearPropertyNames(); // Frees all of the interned property names
+void indexPropertyList(List* list); // Indexes a property list by name. The list keeps the index up to date from then on
+void indexLongPropertyList(List* list); // Indexes a property list that was just read if it has enough properties to be worth it
+void unindexPropertyList(List* list); // Stops indexing a property list and frees the index
+int countPropertiesNamed(List props, const char* name); // Returns how many properties have the name, O(1) if the list is indexed
+Property* findPropertyNamed(List props, const char* name); // Returns the first property with the name, O(1) if the list is indexed
+Property** getPropertiesNamed(List props, const char* name, int* count); // Returns every property with the name from an indexed list, in list order
+void countPropertyKinds(List props, int counts[PROP_KIND_COUNT]); // Counts how many properties of each kind are in the list
+void indexEventList(List* list); // Indexes a list of events by UID. The list keeps the index up to date from then on
+void unindexEventList(List* list); // Stops indexing a list of events and frees the index
+Event* findIndexedEvent(List events, const char* UID); // Returns the first event added to an indexed list with the UID
 void safelyFreeString(char* c); // Frees a string but checks to see if it is null first
+char* replaceField(Arena* arena, char* field, const char* value); // Returns a copy of value for a variable length field and frees the old field if it was malloced
 Property* createProperty(char* propName, char* propDescr); // Create a property from a name and a description
 Alarm* createAlarm(char* action, char* trigger, List properties); // Create an alarm given and action and a trigger and a list of properties
 Alarm* createAlarmFromPropList(List props); // Creates an alarm from a list of properties
-char* extractSubstringBefore(char* line, char* terminator); // returns a copy of the string up to the terminator
-char* extractSubstringAfter(char* line, char* terminator); // Returns a copy of the string after the terminator
+char* extractSubstringBefore(const char* line, char* terminator); // returns a copy of the string up to the terminator
+char* extractSubstringAfter(const char* line, char* terminator); // Returns a copy of the string after the terminator
 Property* extractPropertyFromLine(char* line); // Given a line, extract a property from it
+Property* extractPropertyFromView(const char* line, size_t length, Arena* arena); // Given a line that is not null terminated, extract a property from it (in the arena if there is one)
+Property* createPropertyFromView(const char* propName, size_t nameLength, const char* propDescr, size_t descrLength, int withParameters, Arena* arena); // Create a property from a name and description that are not null terminated, picking out its parameters if withParameters is set
+unsigned int scanPropertyParameters(const char* descr, size_t length, PropertyParameter* params, unsigned int* valueOffset); // Finds the parameters at the start of a description and where its value starts
+Property* appendToProperty(Property* p, const char* c, size_t n, Arena* arena); // Appends n chars to the description of a property and returns the (possibly moved) property
+Property* copyProperty(const Property* p, Arena* arena); // Returns a structural copy of the property, in the arena if there is one
+const char* printedSeparator(const Property* p); // Returns what goes between the name and description of a printed property
 int matchTEXTField(const char* line); // checks to see if a string matches a valid ICAL TEXT field
 int matchDATEField(const char* line);
-int matchURIField(char* line);
-int matchTEXTListField(char* line);
-int matchLONGLATField(char* line);
-int matchDURATIONField(char* line);
-int matchEMAILField(char* line);
+int matchURIField(const char* line);
+int matchTEXTListField(const char* line);
+int matchLONGLATField(const char* line);
+int matchDURATIONField(const char* line);
+int matchEMAILField(const char* line);
 int matchSUMMARYField(const char* line);
+int isTEXTChar(unsigned char c); // Returns 1 if the char can appear in a TEXT field
+unsigned int uriClosure(unsigned int states); // Adds the URI scanner states reachable without reading a char
+unsigned int uriStep(unsigned int states, unsigned char c); // Advances the URI scanner states over one char
+const char* scanDecimal(const char* c); // Scans an optionally signed decimal and returns a pointer past it or NULL
 /**
   *Takes a file that has been opened and reads the lines into a linked list of chars*
   *with each node being one line of the file.
   *@param: file
   * The file to be read. Note the file must be open
   *@param: bufferSize
-  * The maximum size of each line
+  * The initial size of the buffer used to unfold each line
   *@return: list
   * The list with each line read into it
 */
 ICalErrorCode readLinesIntoList(char* fileName, List* list, int bufferSize);
-// Deletes a property from a list given the string representation of it
-void deleteProperty(List* propList, char* line);
-ICalErrorCode extractBetweenTags(List props, List* extracted, ICalErrorCode onFailError, char* tag);
+/**
+  *Which properties the tokenizer keeps. The lines of any other property are skipped without being copied
+*/
+typedef struct propertyFilter {
+	//1 for each kind of property that is kept
+	unsigned char kinds[PROP_KIND_COUNT];
+	//Names that are kept which are not a known kind. Compared ignoring case
+	char* const* others;
+	int otherCount;
+} PropertyFilter;
+/**
+  *Memory maps the file and tokenizes it in place into a list of properties.
+  *Produces exactly the same list and errors as readLinesIntoList when filter is NULL
+*/
+ICalErrorCode readMappedLinesIntoList(char* fileName, List* list, const PropertyFilter* filter);
+/**
+  *Tokenizes a buffer (that does not have to be null terminated) into a list of properties.
+  *Lines are only copied out of the buffer when they have to be unfolded
+*/
+ICalErrorCode readBufferIntoList(const char* buffer, size_t length, List* list, const PropertyFilter* filter);
+ssize_t readFromFile(void* context, char* data, size_t length); // Source that reads from the FILE* in context
+ssize_t readFromFd(void* context, char* data, size_t length); // Source that reads from the file descriptor context points to, trying again when interrupted
+int writeToFd(void* context, const char* data, size_t length); // Sink that writes all of the data to the file descriptor context points to, however many writes it takes
+ICalErrorCode readFileIntoBuffer(char* fileName, char** buffer, size_t* length); // Reads a whole iCalendar file into a new buffer, rejecting the same files readMappedLinesIntoList does
+ICalErrorCode createLazyCalendarFromBuffer(const char* buffer, size_t length, Calendar* calendar); // Checks the structure of a calendar and leaves its events to be decoded when they are used
+size_t scanLogicalLine(const char* buffer, size_t length); // Returns the length of a line together with its continuations
+ICalErrorCode finishLazyEvent(Calendar* calendar, Event* event, const char* lines, size_t length, Property* UID, Property* DTSTAMP); // Sets up a lazily parsed event and puts it in the calendar
+void returnLazyEventLines(Calendar* calendar, Event* event, const char* lines, size_t length, Property* UID, Property* DTSTAMP); // Gives the lines of a broken lazily parsed event back to the calendar
+struct eventLoader;
+void decodeEventLines(struct eventLoader* loader); // Decodes the lines of a lazily parsed event into its properties and alarms. Only called by loadEvent, which makes sure it happens once
+ICalErrorCode unfoldBufferIntoList(const char* buffer, size_t length, List* list, const PropertyFilter* filter); // Same as readBufferIntoList, but a buffer without properties is not an error
+void initializePropertyFilter(PropertyFilter* filter, char* const names[], int count); // Sets up a filter that keeps the named properties and the ones every calendar needs
+int propertyFilterKeeps(const PropertyFilter* filter, const char* line, size_t length); // Returns 0 if the line starts a property the filter leaves out
+ICalErrorCode parseUnfoldedLine(const char* line, size_t length, List* list); // Extracts the property from a complete (unfolded) line and inserts it into the list
+void appendToLine(char** line, size_t* length, size_t* capacity, const char* c, size_t n); // Appends n chars to a growable line
+int isFoldedLine(const char* line, size_t length); // Returns 1 if the line is the continuation of a folded line
+int isPropertyLine(const char* line, size_t length); // Returns 1 if the line looks like NAME:description or NAME;description
+ICalErrorCode createCalendarFromLines(List iCalPropertyList, Calendar* calendar); // Builds the calendar out of the properties read from the file in one pass
+void returnEventLines(Calendar* calendar, Event* event, Property* eventBegin); // Gives the lines of a broken event back to the calendar
+int isComponentTag(const Property* p, PropertyKind tag, const char* component); // Returns 1 if the property is BEGIN:component or END:component
+void moveListElements(List* from, List* to); // Moves every element of from onto the back of to
+Calendar* newEmptyCalendar(); // Creates an empty calendar
+Calendar* newArenaCalendar(); // Creates an empty calendar that owns an arena for everything in it
+void deleteArenaCalendar(Calendar* obj); // Deletes a calendar that owns an arena by freeing the arena
+void deleteProperty(List* propList, Property* p); // Removes the property itself from a list and frees it
 char* printDatePretty(DateTime dt); // Prints a pretty version of a date
-ICalErrorCode createTime(Event* event, char* timeString); // Creates a DateTime and allocates it to the given event if the timeString can be parsed
-void removeIntersectionOfLists(List* l1, List l2); // Removes all nodes from l1 that are found in l2
+ICalErrorCode createTime(Event* event, const char* timeString); // Creates a DateTime and allocates it to the given event if the timeString can be parsed
 Event* newEmptyEvent(); // Creates an empty event
+Event* newEmptyEventInArena(Arena* arena); // Creates an empty event in the arena
 List copyPropList(List toBeCopied); // Returns a new list with the sent list's nodes copied into it
-void updateLongestLineAndIncrementStringSize(size_t* longestLine, size_t* lineLength, size_t* stringSize); // Calculates the longest line
-void concatenateLine(char* string, const char* c, ... ); // concatenate all 'c's to string
-void calculateLineLength(size_t* lineLength, const char* c, ... ); // Sums the length of all strings sent to it
+void appendDate(StringBuilder* string, DateTime dt); // Appends a date the way printDatePretty prints it
+void appendProperty(StringBuilder* string, const Property* p); // Appends a property the way printPropertyListFunction prints it
+void appendPropertyLines(StringBuilder* string, List props, const char* indent); // Appends each property on a line of its own after the indent
+void appendExportField(StringBuilder* string, const char* field); // Appends a space and the field with its length in front of it
+void appendExportProperties(StringBuilder* string, List props); // Appends an exported P record for each property
+size_t longestLineLength(const char* string); // Returns the length of the longest line, counting its new line
+ICalErrorCode writeCalendarToTemp(const char* fileName, const Calendar* obj, char** tempName, int* fd); // Writes the calendar into a new temp file next to fileName and leaves it open
+int openTempFile(const char* fileName, char** tempName); // Creates a new temp file next to fileName and returns it open for writing, or -1
+void syncDirectory(const char* fileName); // Syncs the directory the file is in so a rename into it is durable
 
 /**
-  *Main function to create an event
+  *Main function to create an event. Sorts the event's lines into its properties and alarms
 */
 ICalErrorCode createEvent(List eventList, Event* event);
 /**
   *Checks to see if the required iCalendar tags are present
 */
 ICalErrorCode parseRequirediCalTags(List* list, Calendar* cal);
+int parseVersion(const Property* p, float* version); // Reads the number out of a VERSION property, returning 0 if it is not a version number
+const char* parseProdID(const Property* p); // Returns where the ID starts in a PRODID property, or NULL if it is not valid TEXT
+ICalErrorCode validateEvent(const Calendar* obj, Event* ev); // Checks one event and its alarms the way validateCalendar does
 bool compareTags(const void* first, const void* second); // Predicate for comparing product tags
-int getSpaces(char* line); // Gets the number of preceeding spaces before the start of a string
 int fileExists(char* file); // Returns 0 if the file does not exist, and 1 if it does
@@ -13,6 +13,9 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "Arena.h"
+#include "StringBuilder.h"
+
 /**
  * Node of a linked list. This list is doubly linked, meaning that it has points to both the node immediately in front
  * of it, as well as the node immediately behind it.
@@ -23,6 +26,25 @@ typedef struct listNode{
     struct listNode* next;
 } Node;
 
+/**
+ * How the elements of a list are stored. A linked list allocates a Node per element, a vector keeps them
+ * side by side in one growable array which is much faster to iterate. A sorted list is a linked list with a skip
+ * list on top that keeps it in order. All of them are used through the same functions
+ **/
+typedef enum listStorage {LIST_LINKED, LIST_VECTOR, LIST_SORTED} ListStorage;
+
+/**
+ * Optional secondary index over the data in a list. The list tells it about everything that goes in or comes out,
+ * so it never goes stale. Index types put this first in their own struct
+ **/
+struct listHead;
+
+typedef struct listIndex {
+    void (*added)(struct listIndex* index, const struct listHead* list, void* data); // Called after data is in its place in the list
+    void (*removed)(struct listIndex* index, void* data); // Called before data is taken out, while it is still valid
+    void (*cleared)(struct listIndex* index); // Called before the list is emptied
+} ListIndex;
+
 /**
  * Metadata head of the list.
  * Contains no actual data but contains
@@ -36,6 +58,11 @@ typedef struct listHead{
     void (*deleteData)(void* toBeDeleted);
     int (*compare)(const void* first,const void* second);
     char* (*printData)(void* toBePrinted);
+    Arena* arena; // Where the nodes come from. NULL means malloc
+    ListStorage storage; // Linked unless the list was made by initializeVectorList
+    void** items; // Elements of a vector, front to back. head and tail are not used by a vector. Where the upper levels of a sorted list start
+    int capacity; // Number of elements items has room for. Number of levels in use for a sorted list
+    ListIndex* index; // Kept up to date by the list if it is set
 } List;
 
 
@@ -46,6 +73,8 @@ typedef struct listHead{
  **/
 typedef struct iter{
 	Node* current;
+	void** item; // Next element when iterating a vector
+	void** end; // One past the last element of the vector
 } ListIterator;
 
 
@@ -57,6 +86,48 @@ typedef struct iter{
 **/
 List initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
 
+/** Same as initializeList, but the nodes of the list come from the arena. Data that was not allocated from
+ * the arena is adopted by it when it is inserted, so freeing the arena deletes it too.
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeListInArena(Arena* arena, char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+/** Same as initializeList, but the elements are kept in one contiguous array that grows by doubling.
+ * Suits lists that are built once and iterated many times. Inserting into a vector or removing from it
+ * invalidates its iterators, so nothing can be deleted from it while it is being iterated. A copy of a vector
+ * List shares its array, and once either of them changes the other must not be used again. Lists are only
+ * vectors when their owner asks for one: none of the lists the calendar functions make are
+ *@return the list struct
+**/
+List initializeVectorList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+/** Same as initializeVectorList, but the array comes from the arena and data is adopted like initializeListInArena
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeVectorListInArena(Arena* arena, char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+/** Same as initializeList, but the list is always kept in the order of compareFunction by a skip list.
+ * Inserting, deleting and finding take O(log n) and every insert goes where insertSorted would put it
+ *@return the list struct
+**/
+List initializeSortedList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+/** Same as initializeSortedList, but the nodes come from the arena and data is adopted like initializeListInArena
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeSortedListInArena(Arena* arena, char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+
+
+/** Lets go of the pool that the calling thread's lists (the ones without an arena) take their nodes from.
+ * Its slabs are freed once every node from them has been freed, on whichever thread that happens. A thread
+ * lets go of its pool when it exits, so this is only needed to free it sooner
+**/
+void freeNodePool();
+
 
 
 /**Function for creating a node for the linked list.
@@ -100,9 +171,19 @@ void insertBack(List* list, void* toBeAdded);
 void clearList(List* list);
 
 
+/** Clears the nodes of the linked list without releasing the data they hold.
+* used when the data has been handed over to another list
+*@pre 'List' type must exist and be used in order to keep track of the linked list.
+*@post the list is empty and its data is untouched
+*@param list pointer to the List-type dummy node
+**/
+void clearListNodes(List* list);
+
+
 /** Uses the comparison function pointer to place the element in the
 * appropriate position in the list.
 * should be used as the only insert function if a sorted list is required.
+* O(log n) for a list made by initializeSortedList, which puts everything inserted into it in order
 *@pre List exists and has memory allocated to it. Node to be added is valid.
 *@post The node to be added will be placed immediately before or after the first occurrence of a related node
 *@param list a pointer to the dummy head of the list containing function pointers for delete and compare, as well
@@ -126,6 +207,30 @@ void insertSorted(List* list, void* toBeAdded);
 void* deleteDataFromList(List* list, void* toBeDeleted);
 
 
+/** Removes the node holding exactly this data from the list without comparing or freeing anything.
+ * changes pointer values of surrounding nodes to maintain list structure.
+ *@pre List must exist and have memory allocated to it
+ *@post the node is gone and the caller owns the data. In a list with an arena that holds for data from malloc once no
+ *       other list of the arena holds it either; data allocated from the arena still belongs to the arena, so hand
+ *       it to arenaDelete rather than freeing it
+ *@param list pointer to the dummy head of the list
+ *@param toBeRemoved pointer to the data that is to be removed from the list
+ *@return on success: void * pointer to data  on failure: NULL
+ **/
+void* removeFromList(List* list, void* toBeRemoved);
+
+
+
+/** Replaces the data at the back of the list, eg. when the last element had to be reallocated.
+ *@pre List must exist and have memory allocated to it
+ *@post the last element is toBeAdded. Nothing is freed. If the list is indexed the replaced data must still be valid
+ *@param list pointer to the dummy head of the list
+ *@param toBeAdded the new data for the back of the list
+ *@return on success: the data that was replaced  on failure (the list is empty): NULL
+ **/
+void* replaceBack(List* list, void* toBeAdded);
+
+
 
 /**Returns a pointer to the data at the front of the list. Does not alter list structure.
  *@pre The list exists and has memory allocated to it
@@ -145,6 +250,17 @@ void* getFromBack(List list);
 
 
 
+/**Returns a pointer to the data at a position in the list. Does not alter list structure.
+ * Constant time for a vector, a linked list is walked from the head
+ *@pre The list exists and has memory allocated to it
+ *@param the list struct
+ *@param position how many elements come before it
+ *@return pointer to the data at the position, or NULL if the list is not that long
+ **/
+void* getElementAt(List list, int position);
+
+
+
 /**Returns a string that contains a string representation of
 the list traversed from  head to tail. Utilize the list's printData function pointer to create the string.
 returned string must be freed by the calling function.
@@ -195,4 +311,14 @@ int getLength(List list);
  **/
 void* findElement(List list, bool (*compare)(const void* first,const void* second), const void* search);
 
+/** Function that finds the first element of the list that compares equal to search, using the list's compare function.
+ * O(log n) for a sorted list, other lists are searched from the front
+ *@pre List exists and is valid
+ *@post List remains unchanged.
+ *@return The first element that compares equal to search.  If there is none, return NULL.
+ *@param list - a list struct
+ *@param search - what to compare the elements with
+ **/
+void* findSorted(List list, const void* search);
+
 #endif
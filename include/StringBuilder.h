@@ -0,0 +1,55 @@
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+// A growable string that knows where it ends, so appending to it never rescans what is already there
+
+#include <stddef.h>
+
+/**
+ * A string that is being built. The string is always null terminated once something has been appended to it
+ **/
+typedef struct stringBuilder {
+	char* string;
+	size_t length;
+	size_t capacity;
+
+	//Set if the string could not grow. Everything appended after that is dropped and finishString returns NULL
+	int failed;
+} StringBuilder;
+
+/** Creates an empty string builder. Nothing is allocated until something is appended
+ *@return the string builder
+ *@param capacity - how many chars to make room for the first time it grows. 0 picks a default
+ **/
+StringBuilder initializeStringBuilder(size_t capacity);
+
+/** Appends n chars to the string. Grows it by doubling, so appending is amortized O(n)
+ **/
+void appendChars(StringBuilder* builder, const char* c, size_t n);
+
+/** Appends a null terminated string
+ **/
+void appendString(StringBuilder* builder, const char* c);
+
+/** Appends every string it is given up to a NULL, eg. appendStrings(builder, "UID:", uid, "\n", NULL)
+ **/
+void appendStrings(StringBuilder* builder, const char* c, ...);
+
+/** Appends the same char n times
+ **/
+void appendRepeated(StringBuilder* builder, char c, size_t n);
+
+/** Appends the string printf would print
+ **/
+void appendFormat(StringBuilder* builder, const char* format, ...);
+
+/** Hands the string over to the caller, who has to free it. The builder is empty afterwards
+ *@return the string (an empty string if nothing was appended), or NULL if it ran out of memory
+ **/
+char* finishString(StringBuilder* builder);
+
+/** Frees the string without handing it over
+ **/
+void freeStringBuilder(StringBuilder* builder);
+
+#endif
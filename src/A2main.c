@@ -113,7 +113,7 @@ void createCalendarObject() {
     userInput[strlen(buff) - 1] = '\0'; // remove the new line char and replace it with null terminator
     valid = matchTEXTField(userInput);
     if (valid) {
-      strcpy(c->prodID, userInput);
+      setCalendarProdID(c, userInput);
     }
   } while(!valid);
 
@@ -162,7 +162,7 @@ void createCalendarObject() {
     userInput[strlen(buff) - 1] = '\0'; // remove the new line char and replace it with null terminator
     valid = matchTEXTField(userInput);
     if (valid) {
-      strcpy(event->UID, userInput);
+      setEventUID(event, userInput);
     }
   } while(!valid);
 
@@ -215,7 +215,7 @@ void createCalendarObject() {
     userInput[strlen(buff) - 1] = '\0'; // remove the new line char and replace it with null terminator
     valid = match(userInput, "^(AUDIO|DISPLAY|EMAIL)$");
     if (valid) {
-      strcpy(alarm->action, userInput);
+      setAlarmAction(alarm, userInput);
     }
   } while(!valid);
 
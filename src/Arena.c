@@ -0,0 +1,257 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file contains the region allocator that calendars are built in
+ * No code was used from previous classes/ sources
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Arena.h"
+
+#define ARENA_FIRST_BLOCK 4096 // Small calendars fit in one page
+#define ARENA_MAX_BLOCK (1 << 20) // Blocks stop doubling here
+#define ARENA_FIRST_BUCKETS 16 // Adopted data is hashed into this many buckets at first, doubling as it fills up
+
+Arena* newArena() {
+  return calloc(sizeof(Arena), 1); // Blocks are added as they are needed
+}
+
+void freeArena(Arena* arena) {
+  if (!arena) {
+    return; // Nothing to free
+  }
+  ArenaForeign** buckets = arena->foreign;
+  size_t bucketCount = arena->foreignBuckets;
+  arena->foreign = NULL; // Anything released while the adopted data is deleted is being deleted anyway
+  arena->foreignBuckets = 0;
+  arena->foreignCount = 0;
+  for (size_t i = 0; i < bucketCount; i++) { // Delete everything that was adopted first since it may point into the blocks
+    ArenaForeign* foreign = buckets[i];
+    while (foreign) {
+      ArenaForeign* next = foreign->next;
+      foreign->deleteData(foreign->data);
+      free(foreign);
+      foreign = next;
+    }
+  }
+  free(buckets);
+  ArenaBlock* block = arena->blocks;
+  while (block) { // Then let go of all the blocks at once
+    ArenaBlock* next = block->next;
+    free(block);
+    block = next;
+  }
+  free(arena->sorted);
+  free(arena); // Bye
+}
+
+// Returns where the block goes in the sorted blocks: the number of blocks that start before p
+static size_t findSortedBlock(const Arena* arena, const void* p) {
+  size_t low = 0;
+  size_t high = arena->blockCount;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if ((const char*) arena->sorted[middle]->data <= (const char*) p) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+// Adds a new block to the sorted blocks. Returns 0 if there was no room for it
+static int addSortedBlock(Arena* arena, ArenaBlock* block) {
+  if (arena->blockCount == arena->sortedCapacity) {
+    size_t capacity = arena->sortedCapacity ? arena->sortedCapacity * 2 : 16;
+    ArenaBlock** sorted = realloc(arena->sorted, capacity * sizeof(ArenaBlock*));
+    if (!sorted) {
+      return 0;
+    }
+    arena->sorted = sorted;
+    arena->sortedCapacity = capacity;
+  }
+  size_t index = findSortedBlock(arena, block->data);
+  memmove(arena->sorted + index + 1, arena->sorted + index, (arena->blockCount - index) * sizeof(ArenaBlock*));
+  arena->sorted[index] = block;
+  arena->blockCount ++;
+  return 1;
+}
+
+void* arenaAlloc(Arena* arena, size_t size) {
+  if (!arena) {
+    return malloc(size); // No arena, no problem
+  }
+  size_t alignment = sizeof(max_align_t);
+  size = (size + alignment - 1) & ~(alignment - 1); // Keep every allocation aligned for any type
+
+  ArenaBlock* block = arena->blocks;
+  if (!block || block->size - block->used < size) { // Not enough room left in the current block
+    size_t blockSize = block ? block->size * 2 : ARENA_FIRST_BLOCK;
+    if (blockSize > ARENA_MAX_BLOCK) {
+      blockSize = ARENA_MAX_BLOCK;
+    }
+    if (blockSize < size) {
+      blockSize = size; // Big allocations get a block to themselves
+    }
+    ArenaBlock* newBlock = malloc(sizeof(ArenaBlock) + blockSize);
+    if (!newBlock || !addSortedBlock(arena, newBlock)) {
+      free(newBlock);
+      return NULL;
+    }
+    newBlock->size = blockSize;
+    newBlock->used = 0;
+    newBlock->next = block;
+    arena->blocks = newBlock;
+    block = newBlock;
+  }
+  void* p = (char*) block->data + block->used;
+  block->used += size;
+  return p;
+}
+
+void* arenaCalloc(Arena* arena, size_t size) {
+  if (!arena) {
+    return calloc(size, 1);
+  }
+  void* p = arenaAlloc(arena, size);
+  if (p) {
+    memset(p, 0, size);
+  }
+  return p;
+}
+
+void* arenaAllocRecycled(Arena* arena, size_t size) {
+  if (arena && arena->recycled) {
+    void* chunk = arena->recycled;
+    memcpy(&arena->recycled, chunk, sizeof(void*)); // The first bytes of a recycled chunk point to the next one
+    return chunk;
+  }
+  return arenaAlloc(arena, size);
+}
+
+void arenaRecycle(Arena* arena, void* chunk) {
+  if (!arena) {
+    free(chunk); // It came from malloc
+    return;
+  }
+  memcpy(chunk, &arena->recycled, sizeof(void*)); // Push it onto the recycled chunks
+  arena->recycled = chunk;
+}
+
+size_t arenaBytesUsed(const Arena* arena, size_t* reserved) {
+  size_t used = 0;
+  size_t total = 0;
+  for (const ArenaBlock* block = arena ? arena->blocks : NULL; block; block = block->next) {
+    used += block->used;
+    total += sizeof(ArenaBlock) + block->size;
+  }
+  if (reserved) {
+    *reserved = total;
+  }
+  return used;
+}
+
+// Returns 1 if p is in the part of the block that has been handed out
+static int blockHolds(const ArenaBlock* block, const void* p) {
+  const char* start = (const char*) block->data;
+  return (const char*) p >= start && (const char*) p < start + block->used;
+}
+
+int arenaOwns(const Arena* arena, const void* p) {
+  if (!arena || !p || !arena->blocks) {
+    return 0;
+  }
+  if (blockHolds(arena->blocks, p)) {
+    return 1; // The most recent block is usually the one
+  }
+  size_t index = findSortedBlock(arena, p); // The only block p can be in is the last one that starts before it
+  return index > 0 && blockHolds(arena->sorted[index - 1], p);
+}
+
+// Returns the bucket adopted data goes in. The low bits of an address are mostly alignment, so they are mixed in from higher up
+static size_t foreignBucket(const void* data, size_t bucketCount) {
+  size_t hash = (size_t) data;
+  hash ^= hash >> 4;
+  hash *= 0x9E3779B1u;
+  return (hash ^ (hash >> 16)) & (bucketCount - 1);
+}
+
+// Returns where the record of adopted data is linked from, or where it would be linked from if there is none
+static ArenaForeign** findForeign(const Arena* arena, const void* data) {
+  ArenaForeign** foreign = &arena->foreign[foreignBucket(data, arena->foreignBuckets)];
+  while (*foreign && (*foreign)->data != data) {
+    foreign = &(*foreign)->next;
+  }
+  return foreign;
+}
+
+// Doubles the number of buckets once there are as many records as buckets. Returns 0 if there was no room for them
+static int growForeign(Arena* arena) {
+  if (arena->foreignCount < arena->foreignBuckets) {
+    return 1;
+  }
+  size_t bucketCount = arena->foreignBuckets ? arena->foreignBuckets * 2 : ARENA_FIRST_BUCKETS;
+  ArenaForeign** buckets = calloc(bucketCount, sizeof(ArenaForeign*));
+  if (!buckets) {
+    return arena->foreignBuckets > 0; // Chains just get longer
+  }
+  for (size_t i = 0; i < arena->foreignBuckets; i++) {
+    ArenaForeign* foreign = arena->foreign[i];
+    while (foreign) {
+      ArenaForeign* next = foreign->next;
+      size_t bucket = foreignBucket(foreign->data, bucketCount);
+      foreign->next = buckets[bucket];
+      buckets[bucket] = foreign;
+      foreign = next;
+    }
+  }
+  free(arena->foreign);
+  arena->foreign = buckets;
+  arena->foreignBuckets = bucketCount;
+  return 1;
+}
+
+void arenaAdopt(Arena* arena, void* data, void (*deleteData)(void* toBeDeleted)) {
+  if (!arena || !data || !growForeign(arena)) {
+    return;
+  }
+  ArenaForeign** link = findForeign(arena, data);
+  if (*link) {
+    (*link)->count ++; // Already adopted, by another list it is in or by the one it is moving to
+    return;
+  }
+  ArenaForeign* foreign = malloc(sizeof(ArenaForeign)); // Not from the arena so it can be released one at a time
+  if (!foreign) {
+    return;
+  }
+  foreign->data = data;
+  foreign->deleteData = deleteData;
+  foreign->count = 1;
+  foreign->next = NULL;
+  *link = foreign;
+  arena->foreignCount ++;
+}
+
+void arenaRelease(Arena* arena, void* data) {
+  if (!arena || !arena->foreign) {
+    return;
+  }
+  ArenaForeign** link = findForeign(arena, data);
+  ArenaForeign* released = *link;
+  if (!released || -- released->count > 0) {
+    return; // Never adopted, or still adopted by something else
+  }
+  *link = released->next; // Unlink it
+  free(released);
+  arena->foreignCount --;
+}
+
+void arenaDelete(Arena* arena, void* data, void (*deleteData)(void* toBeDeleted)) {
+  if (!data || arenaOwns(arena, data)) {
+    return; // freeArena takes care of it
+  }
+  deleteData(data);
+}
@@ -9,10 +9,19 @@
 #define _GNU_SOURCE
 
 #include <regex.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
-#include <stdarg.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "CalendarParser.h"
+#include "CalendarWriter.h"
 #include "HelperFunctions.h"
 
 
@@ -28,97 +37,283 @@
  *@param fileName - a string containing the name of the iCalendar file
  *@param a double pointer to a Calendar struct that needs to be allocated
 **/
+// Returns the error, first deleting the calendar and setting obj to NULL if it is not OK, so nothing that was made is handed back
+static ICalErrorCode handBackCalendar(ICalErrorCode error, Calendar** obj) {
+  if (error != OK) {
+    deleteCalendar(*obj);
+    *obj = NULL;
+  }
+  return error;
+}
+
 ICalErrorCode createCalendar(char* fileName, Calendar** obj) {
-  *obj = calloc(sizeof(Calendar), 1);
-  Calendar* calendar = *obj;
+  *obj = newArenaCalendar(); // Everything parsed out of the file lives in the calendar's arena
 
-  strcpy(calendar->prodID, ""); // Ensure that this field is not blank to prevent uninitialized conditional jump errors in valgrind
-  calendar->version = -1;
-  List events = initializeList(&printEventListFunction, &deleteEventListFunction, &compareEventListFunction);
-  calendar->events = events; // Assign the empty event list
+  List iCalPropertyList = initializeListInArena((*obj)->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Create a list to store all properties/ lines
+  ICalErrorCode lineCheckError = readLinesIntoList(fileName, &iCalPropertyList, 512); // Read the lines of the file into a list of properties
+  if (lineCheckError != OK) { // If any of the lines were invalid, this will not return OK
+    clearList(&iCalPropertyList); // Clear the list before returning
+    return handBackCalendar(lineCheckError, obj); // Return the error that was produced
+  }
 
-  // List to store calendar properties
-  List betweenVCalendarTags = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
-  calendar->properties = betweenVCalendarTags;
+  return handBackCalendar(createCalendarFromLines(iCalPropertyList, *obj), obj);
+}
 
-  List iCalPropertyList = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Create a list to store all properties/ lines
-  ICalErrorCode lineCheckError = readLinesIntoList(fileName, &iCalPropertyList, 512); // Read the lines of the file into a list of properties
+/** Function to create a Calendar object by memory mapping an iCalendar file and tokenizing it in place.
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendar, which this function is interchangeable with
+ *@return the error code indicating success or the error encountered when parsing the calendar
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarMapped(char* fileName, Calendar** obj) {
+  *obj = newArenaCalendar(); // Everything parsed out of the file lives in the calendar's arena
+
+  List iCalPropertyList = initializeListInArena((*obj)->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Create a list to store all properties/ lines
+  ICalErrorCode lineCheckError = readMappedLinesIntoList(fileName, &iCalPropertyList, NULL); // Tokenize the mapped file into a list of properties
   if (lineCheckError != OK) { // If any of the lines were invalid, this will not return OK
     clearList(&iCalPropertyList); // Clear the list before returning
-    return lineCheckError; // Return the error that was produced
+    return handBackCalendar(lineCheckError, obj); // Return the error that was produced
   }
 
+  return handBackCalendar(createCalendarFromLines(iCalPropertyList, *obj), obj);
+}
 
-  // Get the properties between event tags
-  ICalErrorCode betweenVCalendarTagsError = extractBetweenTags(iCalPropertyList, &betweenVCalendarTags, INV_CAL, "VCALENDAR");
-  if (betweenVCalendarTagsError != OK) { // If there was a problem parsing
-    clearList(&iCalPropertyList); // Free lists before returning
-    clearList(&betweenVCalendarTags);
-    return betweenVCalendarTagsError; // Return the error that was produced
+/** Function to create a Calendar object that only has the properties with the given names.
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendarMapped, except that lines of any other property are skipped by the tokenizer
+ *@return the error code indicating success or the error encountered when parsing the calendar
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+ *@param propertyNames - the names of the properties to keep, in any case
+ *@param count - how many names there are
+**/
+ICalErrorCode createCalendarWithProperties(char* fileName, Calendar** obj, char* const propertyNames[], int count) {
+  if (count < 0 || (count > 0 && !propertyNames)) {
+    *obj = NULL; // Nothing is made for arguments that cannot be used
+    return OTHER_ERROR;
   }
+  *obj = newArenaCalendar(); // Everything parsed out of the file lives in the calendar's arena
 
-  // List to store event properties
-  List betweenVEventTags = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  PropertyFilter filter;
+  initializePropertyFilter(&filter, propertyNames, count);
+  List iCalPropertyList = initializeListInArena((*obj)->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Create a list to store all properties/ lines
+  ICalErrorCode lineCheckError = readMappedLinesIntoList(fileName, &iCalPropertyList, &filter); // Tokenize only the wanted lines of the mapped file
+  if (lineCheckError != OK) { // If any of the lines were invalid, this will not return OK
+    clearList(&iCalPropertyList); // Clear the list before returning
+    return handBackCalendar(lineCheckError, obj); // Return the error that was produced
+  }
 
-  ICalErrorCode eventTagsError;
-  // While we still have VALARM tags
-  while ((eventTagsError = extractBetweenTags(betweenVCalendarTags, &betweenVEventTags, INV_EVENT, "VEVENT")) != INV_EVENT) {
-    // If there is an event, check the event error
-    if (eventTagsError != OK) {
-      clearList(&iCalPropertyList); // Clear lists before returning
-      clearList(&events);
-      clearList(&betweenVCalendarTags);
-      clearList(&betweenVEventTags);
-      return eventTagsError; // Return the error that was produced
-    }
-    Event* event = newEmptyEvent();
+  return handBackCalendar(createCalendarFromLines(iCalPropertyList, *obj), obj);
+}
 
-    ICalErrorCode eventError = createEvent(betweenVEventTags, event); // Create and event given the event properties that were extracted
-    if (eventError != OK) { // If there was a problem
-      clearList(&iCalPropertyList); // Clear list before returning
-      clearList(&events);
-      clearList(&betweenVCalendarTags);
-      clearList(&betweenVEventTags);
-      events.deleteData(event); // Remove the event
-      return eventError; // Return the error that was produced
+/** Function to create a Calendar object whose events are only decoded when they are used.
+ *@pre File name cannot be an empty string or NULL.  File name must have the .ics extension.
+       File represented by this name must exist and must be readable.
+ *@post Same as createCalendar, except that the properties and alarms of each event are decoded the first time
+        either of its lists is used
+ *@return the error code indicating success or the error encountered when checking the structure of the calendar
+ *@param fileName - a string containing the name of the iCalendar file
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarLazy(char* fileName, Calendar** obj) {
+  *obj = newArenaCalendar(); // Everything parsed out of the file lives in the calendar's arena
+
+  char* buffer = NULL;
+  size_t length = 0;
+  ICalErrorCode fileError = readFileIntoBuffer(fileName, &buffer, &length);
+  if (fileError != OK) {
+    return handBackCalendar(fileError, obj);
+  }
+  arenaAdopt((*obj)->arena, buffer, &free); // The events decode their lines out of it when they are used
+  return handBackCalendar(createLazyCalendarFromBuffer(buffer, length, *obj), obj);
+}
+
+/** Function to create a Calendar object from iCalendar text that is already in memory.
+ *@pre Buffer is not NULL unless length is 0
+ *@post Same as createCalendarMapped, which hands this function the mapping of the file
+ *@return the error code indicating success or the error encountered when parsing the calendar
+ *@param buffer - the iCalendar text, which does not have to be null terminated
+ *@param length - how many bytes of it there are
+ *@param a double pointer to a Calendar struct that needs to be allocated
+**/
+ICalErrorCode createCalendarFromBuffer(const char* buffer, size_t length, Calendar** obj) {
+  *obj = NULL;
+  if (!buffer && length > 0) {
+    return INV_FILE; // Nothing to read
+  }
+  *obj = newArenaCalendar(); // Everything parsed out of the buffer lives in the calendar's arena
+
+  List iCalPropertyList = initializeListInArena((*obj)->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Create a list to store all properties/ lines
+  ICalErrorCode error = readBufferIntoList(buffer, length, &iCalPropertyList, NULL); // Properties are copied out of the buffer
+  if (error != OK) { // If any of the lines were invalid, this will not return OK
+    clearList(&iCalPropertyList); // Clear the list before returning
+  } else {
+    error = createCalendarFromLines(iCalPropertyList, *obj);
+  }
+  return handBackCalendar(error, obj);
+}
+
+/**
+  *Reads from readSome until it reports the end into a new buffer, which the caller has to free.
+  *sizeHint is how much is expected, or 0 if that is not known. The buffer grows if there is more
+*/
+static ICalErrorCode readStreamIntoBuffer(ssize_t (*readSome)(void* context, char* data, size_t length), void* context, size_t sizeHint, char** buffer, size_t* length) {
+  size_t capacity = sizeHint + 1; // One more so the end is found without growing
+  if (capacity < 4096) {
+    capacity = 4096;
+  }
+  *length = 0;
+  *buffer = malloc(capacity);
+  while (*buffer) {
+    if (*length == capacity) {
+      char* bigger = realloc(*buffer, capacity * 2);
+      if (!bigger) {
+        break;
+      }
+      *buffer = bigger;
+      capacity *= 2;
+    }
+    ssize_t got = readSome(context, *buffer + *length, capacity - *length);
+    if (got < 0) {
+      break;
+    }
+    if (got == 0) {
+      return OK; // The end
     }
+    *length += got;
+  }
+  safelyFreeString(*buffer);
+  *buffer = NULL;
+  return INV_FILE;
+}
+
+ICalErrorCode createCalendarFromFd(int fd, Calendar** obj) {
+  struct stat fileStat;
+  size_t sizeHint = fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) ? fileStat.st_size : 0; // Pipes and sockets cannot say how much is coming
+  char* buffer = NULL;
+  size_t length = 0;
+  ICalErrorCode readError = readStreamIntoBuffer(&readFromFd, &fd, sizeHint, &buffer, &length);
+  if (readError != OK) {
+    *obj = NULL;
+    return readError;
+  }
+  ICalErrorCode error = createCalendarFromBuffer(buffer, length, obj);
+  free(buffer);
+  return error;
+}
+
+ICalErrorCode createCalendarFromFile(FILE* file, Calendar** obj) {
+  char* buffer = NULL;
+  size_t length = 0;
+  ICalErrorCode readError = file ? readStreamIntoBuffer(&readFromFile, file, 0, &buffer, &length) : INV_FILE;
+  if (readError != OK) {
+    *obj = NULL;
+    return readError;
+  }
+  ICalErrorCode error = createCalendarFromBuffer(buffer, length, obj);
+  free(buffer);
+  return error;
+}
 
-    insertBack(&events, event); // Put her in
+/** Builds the calendar out of the properties read from the file in a single forward pass.
+  Every property is handed to the component that encloses it: the calendar or the event that is open at the time.
+  Events sort their own alarms out afterwards in createEvent. The properties are moved, not copied, and
+  iCalPropertyList is emptied before returning
+*/
+ICalErrorCode createCalendarFromLines(List iCalPropertyList, Calendar* calendar) {
+  int calendarState = 0; // 0 before BEGIN:VCALENDAR, 1 inside the calendar and 2 after END:VCALENDAR
+  int calendarBroken = 0; // Set when the calendar tags are out of order
+  Event* event = NULL; // The event that is currently open
+  Property* eventBegin = NULL; // The BEGIN:VEVENT tag of the open event
+  int eventsBroken = 0; // Set when the event tags are out of order. Everything after that stays with the calendar
+
+  ListIterator linesIterator = createIterator(iCalPropertyList);
+  Property* prop;
+  while ((prop = nextElement(&linesIterator)) != NULL) {
+    if (calendarBroken || calendarState == 2) {
+      arenaDelete(calendar->arena, prop, &deletePropertyListFunction); // Anything after the calendar is ignored
+    } else if (isComponentTag(prop, PROP_BEGIN, "VCALENDAR")) {
+      calendarBroken = calendarState == 1; // Opened another calendar without closing this one
+      calendarState = 1;
+      arenaDelete(calendar->arena, prop, &deletePropertyListFunction);
+    } else if (isComponentTag(prop, PROP_END, "VCALENDAR")) {
+      calendarBroken = calendarState == 0; // Closed a calendar without opening one
+      calendarState = 2;
+      arenaDelete(calendar->arena, prop, &deletePropertyListFunction);
+    } else if (calendarState == 0) {
+      arenaDelete(calendar->arena, prop, &deletePropertyListFunction); // Anything before the calendar is ignored
+    } else if (eventsBroken) {
+      insertBack(&calendar->properties, prop);
+    } else if (isComponentTag(prop, PROP_BEGIN, "VEVENT")) {
+      if (event) { // Opened another event without closing the previous
+        returnEventLines(calendar, event, eventBegin);
+        event = NULL;
+        insertBack(&calendar->properties, prop);
+        eventsBroken = 1;
+      } else {
+        event = newEmptyEventInArena(calendar->arena);
+        eventBegin = prop;
+      }
+    } else if (isComponentTag(prop, PROP_END, "VEVENT")) {
+      if (event) {
+        insertBack(&calendar->events, event); // Put her in. Her lines get sorted out below
+        arenaDelete(calendar->arena, eventBegin, &deletePropertyListFunction);
+        arenaDelete(calendar->arena, prop, &deletePropertyListFunction);
+        event = NULL;
+      } else { // Closed an event without opening one
+        insertBack(&calendar->properties, prop);
+        eventsBroken = 1;
+      }
+    } else if (event) {
+      insertBack(&event->properties, prop); // Park the line in the event until it is sorted
+    } else {
+      insertBack(&calendar->properties, prop);
+    }
+  }
+  clearListNodes(&iCalPropertyList); // Every property has been moved or freed
 
-    removeIntersectionOfLists(&betweenVCalendarTags, betweenVEventTags);
-    deleteProperty(&betweenVCalendarTags, "BEGIN:VEVENT"); // Remove the begin tag
-    deleteProperty(&betweenVCalendarTags, "END:VEVENT"); // Remove the begin tag
-    clearList(&betweenVEventTags);
+  if (event) {
+    returnEventLines(calendar, event, eventBegin); // The last event was never closed
+  }
+  if (calendarBroken || calendarState != 2) {
+    return INV_CAL; // The calendar was missing, unclosed or nested
+  }
 
+  ListIterator eventIterator = createIterator(calendar->events);
+  while ((event = nextElement(&eventIterator)) != NULL) {
+    List eventLines = event->properties;
+    event->properties = initializeListInArena(calendar->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+    ICalErrorCode eventError = createEvent(eventLines, event); // Create the event out of the lines that were parked in it
+    if (eventError != OK) {
+      return eventError; // Return the error that was produced
+    }
   }
 
   // Check to see if there is an event at all
-  if (!events.head) {
-    clearList(&iCalPropertyList); // Clear lists before returning
-    clearList(&betweenVCalendarTags);
-    clearList(&betweenVEventTags);
-    clearList(&events);
+  if (!getFromFront(calendar->events)) {
     return INV_CAL; // If there is no event, then the calendar is invalid
   }
 
-  // // We should only have VERSION and PRODID now
-  ICalErrorCode iCalIdErrors = parseRequirediCalTags(&betweenVCalendarTags, *obj); // Place UID and version in the obj
+  // Place PRODID and version in the obj
+  ICalErrorCode iCalIdErrors = parseRequirediCalTags(&calendar->properties, calendar);
   if (iCalIdErrors != OK) { // If there was a problem
-    clearList(&iCalPropertyList); // Clear lists before returning
-    clearList(&betweenVCalendarTags);
-    clearList(&betweenVEventTags);
-    clearList(&events);
     return iCalIdErrors; // Return the error that was produced
   }
-
-  clearList(&iCalPropertyList); // Clear lists before returning
-  clearList(&betweenVEventTags);
-  calendar->properties = betweenVCalendarTags; // Set the remaining properties to the calendar
-  calendar->events = events; // Assign the empty event list
+  indexLongPropertyList(&calendar->properties);
 
   return validateCalendar(calendar);
 }
 
+// Gives the lines of an event that turned out to be broken back to the calendar, in the order they were read, and frees the event
+void returnEventLines(Calendar* calendar, Event* event, Property* eventBegin) {
+  insertBack(&calendar->properties, eventBegin);
+  moveListElements(&event->properties, &calendar->properties);
+  arenaDelete(calendar->arena, event, &deleteEventListFunction);
+}
+
 /** Function to delete all calendar content and free all the memory.
  *@pre Calendar object exists, is not null, and has not been freed
  *@post Calendar object had been freed
@@ -129,10 +324,17 @@ void deleteCalendar(Calendar* obj) {
   if (obj == NULL) {
     return; // No need to be freed if the object is NULL
   }
+  if (obj->arena) {
+    deleteArenaCalendar(obj);
+    return;
+  }
   List events = obj->events;
   clearList(&events);
+  unindexEventList(&events);
   List properties = obj->properties;
   clearList(&properties);
+  unindexPropertyList(&properties);
+  safelyFreeString(obj->prodID);
 
   free(obj); // Free object? I Like free objects
 }
@@ -152,222 +354,80 @@ char* printCalendar(const Calendar* obj) {
     return NULL;
   }
 
-  char* string;
-  size_t stringSize = 0; // Total size of the completed string
-  size_t lineLength = 0; // Size of the current line we are calculating
-  size_t longestLine = 0; // Length of the lonest line
-
   // PRODUCT ID: Something\n
-  if (strlen(obj->prodID) == 0) {
+  if (strlen(getCalendarProdID(obj)) == 0) {
     return NULL; // Must have a prodID
   }
-  calculateLineLength(&lineLength, " PRODID:", obj->prodID, "\n", NULL); // Add the length of these strings to the lineLength
-  updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
   // VERSION: 2.0\n
   if (!obj->version) {
     return NULL; // Must have a version
   }
-  // Make room for the version string
-  char vString[snprintf(NULL, 0, "%f", obj->version) + 1];
-  snprintf(vString, sizeof(vString) + 1, "%f", obj->version);
 
-  calculateLineLength(&lineLength, " VERSION:", vString, "\n", NULL); // Add the length of these strings to the lineLength
-  updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+  StringBuilder body = initializeStringBuilder(0); // Everything between the caps
+  appendStrings(&body, " PRODID:", getCalendarProdID(obj), "\n", NULL);
+  appendFormat(&body, " VERSION:%f\n", obj->version);
 
-  List events = obj->events;
-  ListIterator eventIter = createIterator(events);
+  ListIterator eventIter = createIterator(obj->events);
   Event* event;
 
   while ((event = nextElement(&eventIter))) {
-    calculateLineLength(&lineLength, " CALENDAR EVENT:\n" , NULL); // Add the length of these strings to the lineLength
-    updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
     // UID: some uid\n
-    if (strlen(event->UID) == 0) {
+    if (strlen(getEventUID(event)) == 0) {
+      freeStringBuilder(&body);
       return NULL;
     }
-
-    calculateLineLength(&lineLength, "  UID:", event->UID, "\n" , NULL); // Add the length of these strings to the lineLength
-    updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
+    appendStrings(&body, " CALENDAR EVENT:\n", "  UID:", getEventUID(event), "\n", NULL);
     // CREATION TIMESTAMP: some time\n
-    char* dtString = printDatePretty(event->creationDateTime);
-    calculateLineLength(&lineLength, "  DTSTAMP:", dtString, "\n" , NULL); // Add the length of these strings to the lineLength
-    safelyFreeString(dtString);
-    updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-    List alarms = event->alarms;
-    if (alarms.head) {
-      ListIterator alarmIterator = createIterator(alarms);
-
-      Alarm* a;
-      while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
-        calculateLineLength(&lineLength, "  ALARM:\n" , NULL); // Add the length of these strings to the lineLength
-        updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-        if (strlen(a->action) == 0) {
-          return NULL; // Action is empty return null
-        }
-        // Get the length of the Action line
-        calculateLineLength(&lineLength, "   ACTION:", a->action, "\n" , NULL); // Add the length of these strings to the lineLength
-        updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-        if (strlen(a->trigger) == 0) {
-          return NULL; // Action is empty return null
-        }
-        // Get the length of the Trigger line
-        calculateLineLength(&lineLength, "   TRIGGER:", a->trigger ,"\n" , NULL); // Add the length of these strings to the lineLength
-        updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-        List alarmProps = a->properties;
-        // Output the props
-        if (alarmProps.head) {
-          calculateLineLength(&lineLength, "   ALARM PROPERTIES:\n" , NULL); // Add the length of these strings to the lineLength
-          updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-          // Get length of each property
-          ListIterator propsIter = createIterator(alarmProps);
-          Property* p;
-
-          while ((p = nextElement(&propsIter)) != NULL) {
-            char* printedProp = printPropertyListFunction(p); // Get the string for this prop
-            calculateLineLength(&lineLength, "      ", printedProp, "\n", NULL); // Add the length of these strings to the lineLength
-            updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-            safelyFreeString(printedProp); // Free the string
-          }
-        }
-      }
-    }
-
-    List propsList = event->properties;
-    if (propsList.head) {
+    appendString(&body, "  DTSTAMP:");
+    appendDate(&body, event->creationDateTime);
+    appendString(&body, "\n");
 
-      calculateLineLength(&lineLength, "  EVENT PROPERTIES:\n", NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-      // Get length of each property
-      ListIterator propsIter = createIterator(propsList);
-      Property* p;
-      while ((p = nextElement(&propsIter)) != NULL) {
-        char* printedProp = printPropertyListFunction(p); // Get the string for this prop
-        calculateLineLength(&lineLength, "   ", printedProp, "\n", NULL); // Add the length of these strings to the lineLength
-        updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-        safelyFreeString(printedProp); //  Free the string
+    loadEvent(event); // Decodes an event from createCalendarLazy. A broken one is printed with whatever it decoded to
+    ListIterator alarmIterator = createIterator(event->alarms);
+    Alarm* a;
+    while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
+      if (strlen(getAlarmAction(a)) == 0 || strlen(a->trigger) == 0) {
+        freeStringBuilder(&body);
+        return NULL; // Action or trigger is empty return null
       }
-    }
-  }
-
-  List calPropsList = obj->properties;
-  if (calPropsList.head) {
-
-    calculateLineLength(&lineLength, " CALENDAR PROPERTIES:\n", NULL); // Add the length of these strings to the lineLength
-    updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-    // Get length of each property
-    ListIterator propsIter = createIterator(calPropsList);
-    Property* p;
-    while ((p = nextElement(&propsIter)) != NULL) {
-      char* printedProp = printPropertyListFunction(p); // Get the string for this prop
-      calculateLineLength(&lineLength, "  ", printedProp, "\n", NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-      safelyFreeString(printedProp); //  Free the string
-    }
-  }
-
-  longestLine += 1; // Make room for null terminator
-
-  //Create the cap and footer of the string representation using by concatonating '-' n times for however long the longest line is
-  char cap[longestLine];
-  for (size_t i = 0; i < longestLine - 1; i++) {
-    cap[i] = '-';
-  }
-  cap[longestLine - 1] = '\n';
-  cap[longestLine] = '\0';
-
-  string = malloc(stringSize * sizeof(char) + (2 * longestLine) + 1); // Allocate memory for the completed string
-
-  strcpy(string, cap); // Header
-
-  // PRODUCT ID: Something\n
-  concatenateLine(string, " PRODID:", obj->prodID, "\n", NULL);
-  // VERSION: 2.0\n
-  concatenateLine(string, " VERSION:", vString, "\n", NULL);
-
-  eventIter = createIterator(events);
-
-  while ((event = nextElement(&eventIter))) {
-    concatenateLine(string, " CALENDAR EVENT:\n", NULL);
-    // UID: some uid\n
-    concatenateLine(string, "  UID:", event->UID, "\n", NULL);
-    // CREATION TIMESTAMP: some time\n
-    char* dtString = printDatePretty(event->creationDateTime);
-    concatenateLine(string, "  DTSTAMP:", dtString, "\n", NULL);
-    safelyFreeString(dtString);
-
-    List alarms = event->alarms;
-    if (alarms.head) {
-      ListIterator alarmIterator = createIterator(alarms);
-
-      Alarm* a;
-      while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
-        concatenateLine(string, "  ALARM:\n", NULL); // Alarm header
-        concatenateLine(string, "   ACTION:", a->action, "\n", NULL); // Alarm action
-        concatenateLine(string, "   TRIGGER:", a->trigger, "\n", NULL); // Alarm trigger
-
-        List alarmProps = a->properties;
-        // Output the props
-        if (alarmProps.head) {
-          concatenateLine(string, "   ALARM PROPERTIES:\n", NULL); // Alarm properties header
-
-          // Get each property string
-          ListIterator propsIter = createIterator(alarmProps);
-          Property* p;
-
-          while ((p = nextElement(&propsIter)) != NULL) {
-            char* printedProp = printPropertyListFunction(p);
-            concatenateLine(string, "    ", printedProp, "\n", NULL); // Alarm properties
-            safelyFreeString(printedProp); // Free the string
-          }
-        }
+      appendString(&body, "  ALARM:\n"); // Alarm header
+      appendStrings(&body, "   ACTION:", getAlarmAction(a), "\n", NULL); // Alarm action
+      appendStrings(&body, "   TRIGGER:", a->trigger, "\n", NULL); // Alarm trigger
+      if (getFromFront(a->properties)) {
+        appendString(&body, "   ALARM PROPERTIES:\n"); // Alarm properties header
+        appendPropertyLines(&body, a->properties, "    ");
       }
     }
 
     // EVENT PROPERTIES: \n
-    List propsList = event->properties;
-    if (propsList.head) {
-      concatenateLine(string, "  EVENT PROPERTIES:\n", NULL); // Event properties header
-
-      // print each property
-      ListIterator propsIter = createIterator(propsList);
-      Property* p;
-
-      while ((p = nextElement(&propsIter)) != NULL) {
-        char* printedProp = printPropertyListFunction(p);
-        concatenateLine(string, "   ", printedProp, "\n", NULL); // Event properties
-        safelyFreeString(printedProp);
-      }
+    if (getFromFront(event->properties)) {
+      appendString(&body, "  EVENT PROPERTIES:\n"); // Event properties header
+      appendPropertyLines(&body, event->properties, "   ");
     }
   }
 
-  // EVENT PROPERTIES: \n
-  if (calPropsList.head) {
-    concatenateLine(string, " CALENDAR PROPERTIES:\n", NULL); // Event properties header
-
-    // print each property
-    ListIterator propsIter = createIterator(calPropsList);
-    Property* p;
+  // CALENDAR PROPERTIES: \n
+  if (getFromFront(obj->properties)) {
+    appendString(&body, " CALENDAR PROPERTIES:\n");
+    appendPropertyLines(&body, obj->properties, "  ");
+  }
 
-    while ((p = nextElement(&propsIter)) != NULL) {
-      char* printedProp = printPropertyListFunction(p);
-      concatenateLine(string, "  ", printedProp, "\n", NULL); // Event properties
-      safelyFreeString(printedProp);
-    }
+  if (body.failed) {
+    freeStringBuilder(&body);
+    return NULL;
   }
 
-  strcat(string, cap); // Footer
+  // The cap and footer are a '-' for every char of the longest line, counting its new line
+  size_t longestLine = longestLineLength(body.string);
+  StringBuilder string = initializeStringBuilder(body.length + 2 * (longestLine + 1) + 1);
+  appendRepeated(&string, '-', longestLine);
+  appendString(&string, "\n"); // Header
+  appendChars(&string, body.string, body.length);
+  appendRepeated(&string, '-', longestLine);
+  appendString(&string, "\n"); // Footer
+  freeStringBuilder(&body);
 
-  return string; // Beam me up
+  return finishString(&string); // Beam me up
 }
 
 
@@ -443,174 +503,207 @@ char* printError(ICalErrorCode err) {
  *@param obj - a pointer to a Calendar struct
  **/
 ICalErrorCode writeCalendar(char* fileName, const Calendar* obj) {
+  return writeCalendars(&fileName, &obj, 1);
+}
 
-  if (!match(fileName, ".+\\.ics$")) { // If the file name does not match the valid ical regex
-    return INV_FILE;
+ICalErrorCode writeCalendars(char* fileNames[], const Calendar* objs[], int count) {
+  if (count < 0) {
+    return OTHER_ERROR;
   }
-
-  FILE* file;
-  if (!((file = fopen(fileName, "w+")))) { // If the file cannot be opened
-    return WRITE_ERROR;
+  for (int i = 0; i < count; i ++) {
+    if (!match(fileNames[i], ".+\\.ics$")) { // If the file name does not match the valid ical regex
+      return INV_FILE;
+    }
   }
-
-  ICalErrorCode error = validateCalendar(obj); // Validate the calendar
-  if (error != OK) {
-    fclose(file); // close the file before returning
-    return error;
+  for (int i = 0; i < count; i ++) {
+    ICalErrorCode error = validateCalendar(objs[i]); // Nothing is touched unless every calendar can be written
+    if (error != OK) {
+      return error;
+    }
   }
 
-  char* string = printCalendar(obj);
-  if (!string) { // If we couldnt parse the calendar into a string
-    fclose(file); // close the file before returning
+  char** tempNames = calloc(count, sizeof(char*));
+  int* fds = malloc(count * sizeof(int));
+  if (count > 0 && (!tempNames || !fds)) {
+    free(tempNames);
+    free(fds);
     return OTHER_ERROR;
   }
-
-  // This structure acts like a sudo stack to determine which tag we should have open
-  char stack[3][80];
-  strcpy(stack[0], "VCALENDAR");
-  strcpy(stack[1], "VEVENT");
-  strcpy(stack[2], "VALARM");
-
-  int stackPointer = 0; // This integer will point to the top of the stack
-
-  const char deliminer[2] = "\n"; // Break the lines of the to string at newline
-
-  fprintf(file, "%s%s\r\n", "BEGIN:", stack[stackPointer]); // Write the begin tag which will always be BEGIN:VCALENDAR in this case
-  // push stack
-  stackPointer ++;
-
-  char *line;
-  line = strtok(string, deliminer);
-  int previousSpaces = 0; // Will hold the spaces preceeding the string on the previous line
-  int currentSpaces = 0; // Will hold the current spaces at the beginning of the line
-  while(line != NULL) { // Process each line of the output
-    if (!match(line, "^-+$")) { // Dont process the caps of the string
-      currentSpaces = getSpaces(line); // Get the currentSpaces at the beginning of the line
-      /*
-        BELOW IS THE MAIN ALGORITHM
-        It essentially checks to see how many spaces at the beginning of a line and depending
-        on if the current spaces are greater than or less than the previous spaces it knows
-        whether to add a begin tag or close the previous tag. The algorithm also skips cosmetic lines in
-        the toString that should not be in the icalendar file. (ex: 'ALARM/EVENT PROPERTIES:' etc...)
-      */
-      if (previousSpaces <= currentSpaces) {
-        if (match(line, "CALENDAR EVENT:") || (match(line, "ALARM:"))) {
-          // push the stack
-          fprintf(file, "%s%s\r\n", "BEGIN:", stack[stackPointer]);
-          stackPointer ++;
-        } else if (match(line, "ALARM PROPERTIES:") || match(line, "EVENT PROPERTIES:") || match(line, "CALENDAR PROPERTIES:")) {
-          previousSpaces = currentSpaces;
-          line = strtok(NULL, deliminer);
-          continue; // we dont want to print these lines
-        } else {
-          size_t len = strlen(line);
-          memmove(line, line+currentSpaces, len - currentSpaces + 1); // Remove spaces from the beginning of line
-          fprintf(file, "%s\r\n", line);
-        }
-      } else if (previousSpaces > currentSpaces) {
-        int difference = previousSpaces - currentSpaces;
-        do {
-          // pop the stack
-          stackPointer --;
-          fprintf(file, "%s%s\r\n", "END:", stack[stackPointer]);
-          difference --;
-        } while(difference > 1);
-        if (match(line, "CALENDAR EVENT:") || (match(line, "ALARM:"))) {
-          // push the stack
-          fprintf(file, "%s%s\r\n", "BEGIN:", stack[stackPointer]);
-          stackPointer ++;
-        } else if (match(line, "ALARM PROPERTIES:") || match(line, "EVENT PROPERTIES:") || match(line, "CALENDAR PROPERTIES:")) {
-          previousSpaces = currentSpaces;
-          line = strtok(NULL, deliminer); // We dont want to print these lines
-          continue;
-        }
-      }
+  ICalErrorCode error = OK;
+  int written = 0; // Calendars whose temp file has been written and closed
+  while (written < count && error == OK) {
+    error = writeCalendarToTemp(fileNames[written], objs[written], &tempNames[written], &fds[written]);
+    written += error == OK;
+  }
+  for (int i = 0; i < written && error == OK; i ++) {
+    if (fsync(fds[i]) != 0) { // The data has to be on disk before the rename can make it visible
+      error = WRITE_ERROR;
     }
-    previousSpaces = currentSpaces;
-    line = strtok(NULL, deliminer);
   }
-  while (stackPointer != 0) { // While we still have items in the stack
-    stackPointer --;
-    fprintf(file, "%s%s\r\n", "END:", stack[stackPointer]);
+  for (int i = 0; i < written; i ++) {
+    if (close(fds[i]) != 0 && error == OK) {
+      error = WRITE_ERROR;
+    }
   }
-  free(string); // Free string
-  fclose(file); // Close file before returning
-  return OK;
+  for (int i = 0; i < written && error == OK; i ++) {
+    if (rename(tempNames[i], fileNames[i]) != 0) {
+      error = WRITE_ERROR;
+    } else {
+      safelyFreeString(tempNames[i]); // Nothing left to clean up
+      tempNames[i] = NULL;
+      syncDirectory(fileNames[i]);
+    }
+  }
+  for (int i = 0; i < count; i ++) {
+    if (tempNames[i]) {
+      unlink(tempNames[i]); // Readers only ever see the old file or the whole new one
+      free(tempNames[i]);
+    }
+  }
+  free(tempNames);
+  free(fds);
+  return error;
 }
 
-int getPropCount(char* propName, List props) {
-  ListIterator propIter = createIterator(props);
-  Property* prop;
-  int count = 0;
-  while ((prop = nextElement(&propIter))) {
-    if (strcasecmp(propName, prop->propName) == 0) {
-      count ++;
-    }
+/**
+  *Writes a calendar into a new temp file next to the file it is for.
+  *On success the temp file is left open so the caller can sync it. On failure it has been closed and
+  *tempName is only set if the file still has to be removed
+*/
+ICalErrorCode writeCalendarToTemp(const char* fileName, const Calendar* obj, char** tempName, int* fd) {
+  if ((*fd = openTempFile(fileName, tempName)) < 0) { // If the file cannot be opened
+    return WRITE_ERROR;
   }
-  return count;
+
+  CalendarWriter writer;
+  initializeFdWriter(&writer, *fd); // Everything goes out in big writes
+  ICalErrorCode error = writeWholeCalendar(&writer, obj);
+  if (finishCalendarWriter(&writer) != OK && error == OK) {
+    error = WRITE_ERROR;
+  }
+  if (error != OK) {
+    close(*fd);
+  }
+  return error;
+}
+
+// Creates a new temp file next to fileName and returns it open for writing, or -1. tempName is set to its name.
+// If fileName already exists the temp file gets its permissions, so renaming it over the file does not change them
+int openTempFile(const char* fileName, char** tempName) {
+  static unsigned int tempCount = 0; // Tells apart the temp files of one process
+  char* name = malloc(strlen(fileName) + 48);
+  if (!name) {
+    return -1;
+  }
+  int fd;
+  do {
+    sprintf(name, "%s.%ld-%u.tmp", fileName, (long) getpid(), __sync_fetch_and_add(&tempCount, 1));
+    fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666); // Same directory so the rename cannot cross file systems
+  } while (fd < 0 && errno == EEXIST);
+  struct stat target;
+  if (fd >= 0 && stat(fileName, &target) == 0 && fchmod(fd, target.st_mode & 0777) != 0) {
+    close(fd);
+    unlink(name);
+    fd = -1;
+  }
+  if (fd < 0) {
+    free(name);
+    return -1;
+  }
+  *tempName = name;
+  return fd;
+}
+
+// Syncs the directory a file is in so that a rename into it survives a crash
+void syncDirectory(const char* fileName) {
+  const char* slash = strrchr(fileName, '/');
+  char* directory = slash ? strndup(fileName, slash == fileName ? 1 : (size_t) (slash - fileName)) : strdup(".");
+  int fd = directory ? open(directory, O_RDONLY | O_DIRECTORY) : -1;
+  if (fd >= 0) {
+    fsync(fd); // Not every file system can sync a directory, and the file itself is already safe
+    close(fd);
+  }
+  free(directory);
 }
 
 ICalErrorCode validateEventProps(const Calendar* obj, Event* event) {
+  int counts[PROP_KIND_COUNT];
+  countPropertyKinds(event->properties, counts); // Count once instead of for every property
   ListIterator eventPropIter = createIterator(event->properties);
   Property* prop;
 
   while ((prop = nextElement(&eventPropIter))) {
-    char* propName = prop->propName;
-    char* propDescr = prop->propDescr;
-    if (match(propName, "^ATTACH$") && matchURIField(propDescr)) {
-      continue;
-    } else if (match(propName, "^CATEGORIES$") && matchTEXTListField(propDescr)) {
-      continue;
-    } else if (match(propName, "^CLASS$") && match(propDescr, "^(PUBLIC|PRIVATE|CONFIDENTIAL)$")) {
-      continue;
-    } else if (match(propName, "^COMMENT$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^DESCRIPTION$") && matchSUMMARYField(propDescr) && getPropCount("DESCRIPTION", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^GEO$") && matchLONGLATField(propDescr)) {
-      continue;
-    } else if (match(propName, "^LOCATION$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^PRIORITY$") && match(propDescr, "^[[:digit:]]$")) {
-      continue;
-    } else if (match(propName, "^RESOURCES$") && matchTEXTListField(propDescr) && getPropCount("RESOURCES", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^STATUS$") && match(propDescr, "^(TENTATIVE|CONFIRMED|CANCELLED)$") && getPropCount("STATUS", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^SUMMARY$") && matchSUMMARYField(propDescr)) {
-      continue;
-    } else if (match(propName, "^DTEND$") && matchDATEField(propDescr) && getPropCount("DTSTART", event->properties) == 1) { // DTEND requires that we have a start
-      continue;
-    } else if (match(propName, "^DTSTART$") && matchDATEField(propDescr) && getPropCount("DTSTART", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^DURATION$") && matchDURATIONField(propDescr)) {
-      continue;
-    } else if (match(propName, "^TRANSP$") && match(propDescr, "^(OPAQUE|TRANSPARENT)$") && getPropCount("TRANSP", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^ATENDEE$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^CONTACT$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^ORGANIZER$") && matchEMAILField(propDescr)) {
-      continue;
-    } else if (match(propName, "^RELATED-TO$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^URL$") && matchURIField(propDescr) && getPropCount("URL", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^EXDATE$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^RDATE$") && matchTEXTField(propDescr)) {
-      continue;
-    } else if (match(propName, "^RRULE") && matchTEXTField(propDescr) && getPropCount("RRULE", event->properties) <= 1) {
-      continue;
-    } else if (match(propName, "CREATED") && matchDATEField(propDescr) && getPropCount("CREATED", event->properties) <= 1) {
-     continue;
-    } else if (match(propName, "LAST-MODIFIED") && matchDATEField(propDescr)) {
-     continue;
-   } else if (match(propName, "SEQUENCE") && match(propDescr, "^[[:digit:]]$")) {
-     continue;
-    } else {
-      // printf("INV EVENT: %s %s\n", propName, propDescr);
+    const char* propDescr = getPropertyValue(prop); // Parameters like TZID= are not part of what is checked
+    int valid = 0;
+    switch (prop->kind) {
+      case PROP_ATTACH:
+        valid = matchURIField(propDescr);
+        break;
+      case PROP_URL:
+        valid = matchURIField(propDescr) && counts[PROP_URL] <= 1;
+        break;
+      case PROP_CATEGORIES:
+        valid = matchTEXTListField(propDescr);
+        break;
+      case PROP_RESOURCES:
+        valid = matchTEXTListField(propDescr) && counts[PROP_RESOURCES] <= 1;
+        break;
+      case PROP_CLASS:
+        valid = match(propDescr, "^(PUBLIC|PRIVATE|CONFIDENTIAL)$");
+        break;
+      case PROP_COMMENT:
+      case PROP_LOCATION:
+      case PROP_ATTENDEE:
+      case PROP_CONTACT:
+      case PROP_RELATED_TO:
+      case PROP_EXDATE:
+      case PROP_RDATE:
+        valid = matchTEXTField(propDescr);
+        break;
+      case PROP_RRULE:
+        valid = matchTEXTField(propDescr) && counts[PROP_RRULE] <= 1;
+        break;
+      case PROP_DESCRIPTION:
+        valid = matchSUMMARYField(propDescr) && counts[PROP_DESCRIPTION] <= 1;
+        break;
+      case PROP_SUMMARY:
+        valid = matchSUMMARYField(propDescr);
+        break;
+      case PROP_GEO:
+        valid = matchLONGLATField(propDescr);
+        break;
+      case PROP_PRIORITY:
+      case PROP_SEQUENCE:
+        valid = match(propDescr, "^[[:digit:]]$");
+        break;
+      case PROP_STATUS:
+        valid = match(propDescr, "^(TENTATIVE|CONFIRMED|CANCELLED)$") && counts[PROP_STATUS] <= 1;
+        break;
+      case PROP_DTEND:
+        valid = matchDATEField(propDescr) && counts[PROP_DTSTART] == 1; // DTEND requires that we have a start
+        break;
+      case PROP_DTSTART:
+      case PROP_CREATED:
+        valid = matchDATEField(propDescr) && counts[prop->kind] <= 1;
+        break;
+      case PROP_LAST_MODIFIED:
+        valid = matchDATEField(propDescr);
+        break;
+      case PROP_DURATION:
+        valid = matchDURATIONField(propDescr);
+        break;
+      case PROP_TRANSP:
+        valid = match(propDescr, "^(OPAQUE|TRANSPARENT)$") && counts[PROP_TRANSP] <= 1;
+        break;
+      case PROP_ORGANIZER:
+        valid = matchEMAILField(propDescr);
+        break;
+      default:
+        valid = 0; // Not something an event can have
+        break;
+    }
+    if (!valid) {
+      // printf("INV EVENT: %s %s\n", prop->propName, propDescr);
       return INV_EVENT;
     }
   }
@@ -619,24 +712,36 @@ ICalErrorCode validateEventProps(const Calendar* obj, Event* event) {
 }
 
 ICalErrorCode validateAlarmProps(const Calendar* obj, Event* event, Alarm* alarm) {
+  int counts[PROP_KIND_COUNT];
+  countPropertyKinds(alarm->properties, counts);
   ListIterator alarmPropIter = createIterator(alarm->properties);
   Property* prop;
 
   while ((prop = nextElement(&alarmPropIter))) {
-    char* propName = prop->propName;
-    char* propDescr = prop->propDescr;
-    if (match(propName, "^ATTACH$") && matchURIField(propDescr)) {
-      continue;
-    } else if (match(propName, "^REPEAT$") && match(propDescr, "^[[:digit:]]+$")) {
-      continue;
-    } else if (match(propName, "^DURATION$") && matchDURATIONField(propDescr)) {
-      continue;
-    } else if (match(propName, "^DESCRIPTION$") && matchSUMMARYField(propDescr) && getPropCount("DESCRIPTION", alarm->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^SUMMARY$") && matchTEXTField(propDescr)) {
-      continue;
-    } else {
-      // printf("INV ALARM: %s %s\n", propName, propDescr);
+    const char* propDescr = getPropertyValue(prop);
+    int valid = 0;
+    switch (prop->kind) {
+      case PROP_ATTACH:
+        valid = matchURIField(propDescr);
+        break;
+      case PROP_REPEAT:
+        valid = match(propDescr, "^[[:digit:]]+$");
+        break;
+      case PROP_DURATION:
+        valid = matchDURATIONField(propDescr);
+        break;
+      case PROP_DESCRIPTION:
+        valid = matchSUMMARYField(propDescr) && counts[PROP_DESCRIPTION] <= 1;
+        break;
+      case PROP_SUMMARY:
+        valid = matchTEXTField(propDescr);
+        break;
+      default:
+        valid = 0; // Not something an alarm can have
+        break;
+    }
+    if (!valid) {
+      // printf("INV ALARM: %s %s\n", prop->propName, propDescr);
       return INV_ALARM;
     }
   }
@@ -645,18 +750,14 @@ ICalErrorCode validateAlarmProps(const Calendar* obj, Event* event, Alarm* alarm
 }
 
 ICalErrorCode validateCalProps(const Calendar* obj) {
+  int counts[PROP_KIND_COUNT];
+  countPropertyKinds(obj->properties, counts);
   ListIterator calPropIter = createIterator(obj->properties);
   Property* prop;
 
   while ((prop = nextElement(&calPropIter))) {
-    char* propName = prop->propName;
-    char* propDescr = prop->propDescr;
-    if (match(propName, "^CALSCALE$") && matchTEXTField(propDescr) && getPropCount("CALSCALE", obj->properties) <= 1) {
-      continue;
-    } else if (match(propName, "^METHOD$") && matchTEXTField(propDescr) && getPropCount("METHOD", obj->properties) <= 1) {
-      continue;
-    } else {
-      // printf("INV CAL: %s %s\n", propName, propDescr);
+    if ((prop->kind != PROP_CALSCALE && prop->kind != PROP_METHOD) || !matchTEXTField(getPropertyValue(prop)) || counts[prop->kind] > 1) {
+      // printf("INV CAL: %s %s\n", prop->propName, prop->propDescr);
       return INV_CAL;
     }
   }
@@ -674,15 +775,24 @@ ICalErrorCode validateCalendar(const Calendar* obj) {
     return OTHER_ERROR; // If the sent object is null
   }
 
+  ListIterator loadIter = createIterator(obj->events);
+  Event* lazyEvent;
+  while ((lazyEvent = nextElement(&loadIter))) { // Decode events from createCalendarLazy first, since createCalendar would have
+    ICalErrorCode loadError = loadEvent(lazyEvent);
+    if (loadError != OK) {
+      return loadError;
+    }
+  }
+
   if (!obj->version) {
     return INV_VER; // Must have a version
   }
 
-  if (strcmp(obj->prodID, "") == 0) {
+  if (strcmp(getCalendarProdID(obj), "") == 0) {
     return INV_CAL; // prodID if missing
   }
 
-  if (!matchTEXTField(obj->prodID)) {
+  if (!matchTEXTField(getCalendarProdID(obj))) {
     return INV_PRODID; // prodID is malformed
   }
 
@@ -694,38 +804,9 @@ ICalErrorCode validateCalendar(const Calendar* obj) {
   Event* ev;
 
   while ((ev = nextElement(&eventIter))) { // Loop through all events
-    if (strlen(ev->UID) < 1) {
-      return INV_EVENT; // UID cannot be blank
-    }
-    DateTime dt = ev->creationDateTime;
-    if (!match(dt.date, "^[[:digit:]]{8}$") || !match(dt.time, "^[[:digit:]]{6}$")) { // Match valid dates
-      return INV_CREATEDT;
-    }
-
-    ICalErrorCode eventPropsError = validateEventProps(obj, ev);
-    if (eventPropsError != OK) {
-      return eventPropsError;
-    }
-
-    ListIterator alarmIter = createIterator(ev->alarms);
-    Alarm* a;
-    while ((a = nextElement(&alarmIter))) {
-      // if (!match(a->action, "^(AUDIO|DISPLAY|EMAIL)$") || (strcmp(a->trigger, "") == 0)) {
-      //   return INV_ALARM;
-      // }
-      //
-      // ListIterator aPropIter = createIterator(a->properties);
-      // Property* ap;
-      //
-      // while ((ap = nextElement(&aPropIter))) {
-      //   if (strlen(ap->propName) == 0) {
-      //     return INV_ALARM;
-      //   }
-      // }
-      ICalErrorCode alarmErrorCode = validateAlarmProps(obj, ev, a);
-      if (alarmErrorCode != OK) {
-        return alarmErrorCode;
-      }
+    ICalErrorCode eventError = validateEvent(obj, ev);
+    if (eventError != OK) {
+      return eventError;
     }
   }
 
@@ -738,275 +819,1236 @@ ICalErrorCode validateCalendar(const Calendar* obj) {
 
 }
 
-// <------START OF HELPER FUNCTIONS----->
-
-/** Function to match the given string to the regex expression
-  Returns 1 if the string matches the pattern is a match
-  Returns 0 if the string does not match the pattern
-*/
-int match(const char* string, char* pattern) {
-  int status;
-  regex_t regex;
-  int d;
-  if ((d = regcomp(&regex, pattern, REG_EXTENDED|REG_NOSUB|REG_ICASE)) != 0) {
-    return 0;
+// Checks one event of a calendar and its alarms the way validateCalendar does
+ICalErrorCode validateEvent(const Calendar* obj, Event* ev) {
+  if (strlen(getEventUID(ev)) < 1) {
+    return INV_EVENT; // UID cannot be blank
+  }
+  DateTime dt = ev->creationDateTime;
+  if (!match(dt.date, "^[[:digit:]]{8}$") || !match(dt.time, "^[[:digit:]]{6}$")) { // Match valid dates
+    return INV_CREATEDT;
   }
 
-  status = regexec(&regex, string, (size_t) 0, NULL, 0);
-  regfree(&regex);
-  if (status != 0) {
-    return 0;
+  ICalErrorCode eventPropsError = validateEventProps(obj, ev);
+  if (eventPropsError != OK) {
+    return eventPropsError;
+  }
+
+  ListIterator alarmIter = createIterator(ev->alarms);
+  Alarm* a;
+  while ((a = nextElement(&alarmIter))) {
+    // if (!match(a->action, "^(AUDIO|DISPLAY|EMAIL)$") || (strcmp(a->trigger, "") == 0)) {
+    //   return INV_ALARM;
+    // }
+    //
+    // ListIterator aPropIter = createIterator(a->properties);
+    // Property* ap;
+    //
+    // while ((ap = nextElement(&aPropIter))) {
+    //   if (strlen(ap->propName) == 0) {
+    //     return INV_ALARM;
+    //   }
+    // }
+    ICalErrorCode alarmErrorCode = validateAlarmProps(obj, ev, a);
+    if (alarmErrorCode != OK) {
+      return alarmErrorCode;
+    }
   }
-  return(1);
+  return OK;
 }
 
-int matchTEXTField(const char* line) {
-  return match(line, "^(;|:){0,1}[^[:cntrl:]\"\\,:;]+$"); // This regex matches valid text lines
+/** Functions to read the variable length fields of a calendar, event and alarm.
+ *@return the field, or an empty string if it was never set.  The string belongs to the object
+ *@param obj - the object to read the field of
+ **/
+const char* getCalendarProdID(const Calendar* obj) {
+  return obj->prodID ? obj->prodID : "";
 }
 
-int matchSUMMARYField(const char* line) {
-  return match(line, "[^[:cntrl:]\"\\:;]+$"); // This regex matches valid text lines
+const char* getEventUID(const Event* event) {
+  return event->UID ? event->UID : "";
 }
 
-int matchDATEField(const char* line) {
-  return match(line, "(:|;){0,1}[[:digit:]]{8}T[[:digit:]]{6}Z{0,1}$"); // This regex matches valid date lines
+const char* getAlarmAction(const Alarm* alarm) {
+  return alarm->action ? alarm->action : "";
 }
 
-int matchURIField(char* line) { //~~~~~~~~Scheme~~~//~AUTHORTY~~~~~~~~~~~~~~~~URL~~~~~~~~~~.extension~~~~~~~~~or~~IP Address~~~~~~~~~~~~~~~~~~~~~~~~~~Port~~~~~~~~~~~~~~~~PATH~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~File extension
-  return match(line, "[[:alpha:]][[:alnum:]+-:\\.]*//([[:alnum:]]+:.+@){0,1}([[:alnum:]]+(\\.[[:alpha:]]+){0,1}|[[:digit:]]{1,3}(\\.[[:digit:]]+){3,})(:[[:digit:]]+){0,1}(/([[:alnum:]-]+/{0,1})+){0,1}(\\.[[:alnum:]]+)*$");
+/** Functions to set the variable length fields of a calendar, event and alarm.
+ *@pre The object exists and is not null
+ *@post The field holds a copy of the string, taken from the object's arena if it has one.  The old value is freed
+ *@param obj - the object to set the field of
+ *@param value - the new value.  Can be any length
+ **/
+void setCalendarProdID(Calendar* obj, const char* prodID) {
+  obj->prodID = replaceField(obj->arena, obj->prodID, prodID);
 }
 
-int matchTEXTListField(char* line) {
-  return match(line, "^[^[:cntrl:]\"\\,:;]+(,[^[:cntrl:]\"\\,:;]+)*$");
+void setEventUID(Event* event, const char* UID) {
+  event->UID = replaceField(event->properties.arena, event->UID, UID); // The event lives wherever its properties do
 }
 
-int matchLONGLATField(char* line) {
-  return match(line, "^[\\+\\-]{0,1}[[:digit:]]+(\\.[[:digit:]]+){0,1};[\\+\\-]{0,1}[[:digit:]]+(\\.[[:digit:]]+){0,1}$");
+void setAlarmAction(Alarm* alarm, const char* action) {
+  alarm->action = replaceField(alarm->properties.arena, alarm->action, action);
 }
 
-int matchEMAILField(char* line) {
-  return match(line, "[[:alnum:]\\.\\-]+@[[:alnum:]\\-]+\\.[[:alnum:]]+(\\.[[:alnum:]]+){0,1}$");
+/** Functions to find, add and delete the events of a calendar.
+ *@pre Calendar object exists and is not null
+ *@post The first lookup by UID indexes the calendar's events. From then on the events list keeps the index up to date
+ *@param obj - a pointer to a Calendar struct
+ **/
+Event* getEventAt(const Calendar* obj, int position) {
+  return getElementAt(obj->events, position);
 }
 
-int matchDURATIONField(char* line) {
-  return 1;
-  // Second: [[:digit:]]+S
-  // minute: [[:digit:]]+M([[:digit:]]+S){0,1}
-  // hour: [[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}
-  // time: (T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)
-  // day: [[:digit:]]+D
-  // date: [[:digit:]]+D((T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)){0,1}
-  return match(line, "([\\+-]{0,1}P([[:digit:]]+D((T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)){0,1}|(T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)|[[:digit:]]+W)|(:|;){0,1}[[:digit:]]{8}T[[:digit:]]{6}Z{0,1})$");
+Event* findEventByUID(Calendar* obj, const char* UID) {
+  if (!obj->events.index) {
+    indexEventList(&obj->events);
+  }
+  return findIndexedEvent(obj->events, UID);
 }
 
-// Check if the string is allocated before freeing it
-void safelyFreeString(char* c) {
-  if (c) {
-    free(c);
+void addEvent(Calendar* obj, Event* event) {
+  insertBack(&obj->events, event); // The index hears about it from the list
+}
+
+int deleteEventByUID(Calendar* obj, const char* UID) {
+  Event* event = findEventByUID(obj, UID);
+  if (!event) {
+    return 0;
   }
+  arenaDelete(obj->events.arena, removeFromList(&obj->events, event), &deleteEventListFunction);
+  return 1;
 }
 
-void deleteEventListFunction(void* toBeDeleted) {
-  Event* event = (Event*) toBeDeleted;
-  if (event != NULL) { // If there is an event
-    List* props = &event->properties; // Grab the props
-    if (props) { // If there are props
-      clearList(props); // Set them free
+void changeEventUID(Calendar* obj, Event* event, const char* UID) {
+  ListIndex* index = obj->events.index;
+  if (index) {
+    index->removed(index, event); // Filed under the old UID
+  }
+  setEventUID(event, UID);
+  if (index) {
+    index->added(index, &obj->events, event);
+  }
+}
+
+char* exportCalendarComponents(const Calendar* obj) {
+  StringBuilder string = initializeStringBuilder(0);
+  appendFormat(&string, "%d\n", getLength(obj->events));
+
+  ListIterator eventIter = createIterator(obj->events);
+  Event* event;
+  while ((event = nextElement(&eventIter))) {
+    loadEvent(event); // Decodes an event from createCalendarLazy
+    DateTime dt = event->creationDateTime;
+    Property* summary = findPropertyNamed(event->properties, "SUMMARY");
+    appendFormat(&string, "E %d %d", getLength(event->properties), getLength(event->alarms));
+    appendExportField(&string, getEventUID(event));
+    appendFormat(&string, " %zu:", strlen(dt.date) + strlen(dt.time) + (dt.UTC ? 2 : 1));
+    appendDate(&string, dt);
+    appendExportField(&string, summary ? getPropertyValue(summary) : "");
+    appendString(&string, "\n");
+    appendExportProperties(&string, event->properties);
+
+    ListIterator alarmIter = createIterator(event->alarms);
+    Alarm* a;
+    while ((a = nextElement(&alarmIter))) {
+      appendFormat(&string, "A %d", getLength(a->properties));
+      appendExportField(&string, getAlarmAction(a));
+      appendExportField(&string, a->trigger);
+      appendString(&string, "\n");
+      appendExportProperties(&string, a->properties);
     }
-    List* alarms = &event->alarms; // Grab the alarms
-    if (alarms) { // If the alarms exist
-      clearList(alarms); // Set them free
+  }
+  return finishString(&string);
+}
+
+// <------START OF HELPER FUNCTIONS----->
+
+// Compiled regular expressions are kept for the life of the process, hashed by their pattern
+#define REGEX_CACHE_BUCKETS 128
+
+typedef struct regexCacheEntry {
+  char* pattern;
+  regex_t regex;
+  int compiled; // 0 if the pattern failed to compile
+  struct regexCacheEntry* next;
+} RegexCacheEntry;
+
+static RegexCacheEntry* regexCache[REGEX_CACHE_BUCKETS];
+static pthread_rwlock_t regexCacheLock = PTHREAD_RWLOCK_INITIALIZER;
+
+/** Function to match the given string to the regex expression
+  Each distinct pattern is only compiled the first time it is used, after which the compiled
+  expression is shared (safely between threads) by every call
+  Returns 1 if the string matches the pattern is a match
+  Returns 0 if the string does not match the pattern
+*/
+int match(const char* string, char* pattern) {
+  RegexCacheEntry* entry = getCompiledRegex(pattern);
+  if (!entry || !entry->compiled) {
+    return 0;
+  }
+
+  int status = regexec(&entry->regex, string, (size_t) 0, NULL, 0);
+  if (status != 0) {
+    return 0;
+  }
+  return(1);
+}
+
+// Returns the cached compiled version of the pattern, compiling it if this is the first time we have seen it
+RegexCacheEntry* getCompiledRegex(const char* pattern) {
+  unsigned long hash = 5381;
+  for (const char* c = pattern; *c; c++) {
+    hash = hash * 33 + (unsigned char) *c;
+  }
+  size_t bucket = hash % REGEX_CACHE_BUCKETS;
+
+  pthread_rwlock_rdlock(&regexCacheLock);
+  RegexCacheEntry* entry = regexCache[bucket];
+  while (entry && strcmp(entry->pattern, pattern) != 0) {
+    entry = entry->next;
+  }
+  pthread_rwlock_unlock(&regexCacheLock);
+  if (entry) {
+    return entry; // Already compiled
+  }
+
+  pthread_rwlock_wrlock(&regexCacheLock);
+  entry = regexCache[bucket];
+  while (entry && strcmp(entry->pattern, pattern) != 0) {
+    entry = entry->next; // Someone else may have compiled it while we were waiting for the lock
+  }
+  if (!entry && (entry = calloc(sizeof(RegexCacheEntry), 1))) {
+    entry->pattern = malloc(strlen(pattern) + 1);
+    strcpy(entry->pattern, pattern);
+    entry->compiled = regcomp(&entry->regex, pattern, REG_EXTENDED|REG_NOSUB|REG_ICASE) == 0;
+    entry->next = regexCache[bucket];
+    regexCache[bucket] = entry;
+  }
+  pthread_rwlock_unlock(&regexCacheLock);
+  return entry;
+}
+
+// Frees every compiled regex. Only call this once no other thread can be calling match
+void clearRegexCache() {
+  pthread_rwlock_wrlock(&regexCacheLock);
+  for (size_t i = 0; i < REGEX_CACHE_BUCKETS; i++) {
+    RegexCacheEntry* entry = regexCache[i];
+    while (entry) {
+      RegexCacheEntry* next = entry->next;
+      if (entry->compiled) {
+        regfree(&entry->regex);
+      }
+      free(entry->pattern);
+      free(entry);
+      entry = next;
     }
-    free(event); // Set it free
+    regexCache[i] = NULL;
   }
+  pthread_rwlock_unlock(&regexCacheLock);
 }
 
-char* printEventListFunction(void *toBePrinted) {
-  size_t longestLine = 0;
-  size_t lineLength = 0;
-  size_t stringSize = 0;
-  Event* event = (Event*) toBePrinted;
+// Property names are worked out once when a property is created. Known names become a PropertyKind through a perfect hash,
+// and every spelling is interned so properties never carry their own copy of the name
+
+// The usual spelling of every kind
+static const char* const propertyKindNames[PROP_KIND_COUNT] = {
+  [PROP_OTHER] = "",
+  [PROP_BEGIN] = "BEGIN", [PROP_END] = "END", [PROP_CALSCALE] = "CALSCALE", [PROP_METHOD] = "METHOD",
+  [PROP_PRODID] = "PRODID", [PROP_VERSION] = "VERSION", [PROP_ATTACH] = "ATTACH", [PROP_CATEGORIES] = "CATEGORIES",
+  [PROP_CLASS] = "CLASS", [PROP_COMMENT] = "COMMENT", [PROP_DESCRIPTION] = "DESCRIPTION", [PROP_GEO] = "GEO",
+  [PROP_LOCATION] = "LOCATION", [PROP_PERCENT_COMPLETE] = "PERCENT-COMPLETE", [PROP_PRIORITY] = "PRIORITY",
+  [PROP_RESOURCES] = "RESOURCES", [PROP_STATUS] = "STATUS", [PROP_SUMMARY] = "SUMMARY", [PROP_COMPLETED] = "COMPLETED",
+  [PROP_DTEND] = "DTEND", [PROP_DUE] = "DUE", [PROP_DTSTART] = "DTSTART", [PROP_DURATION] = "DURATION",
+  [PROP_FREEBUSY] = "FREEBUSY", [PROP_TRANSP] = "TRANSP", [PROP_TZID] = "TZID", [PROP_TZNAME] = "TZNAME",
+  [PROP_TZOFFSETFROM] = "TZOFFSETFROM", [PROP_TZOFFSETTO] = "TZOFFSETTO", [PROP_TZURL] = "TZURL",
+  [PROP_ATTENDEE] = "ATTENDEE", [PROP_CONTACT] = "CONTACT", [PROP_ORGANIZER] = "ORGANIZER",
+  [PROP_RECURRENCE_ID] = "RECURRENCE-ID", [PROP_RELATED_TO] = "RELATED-TO", [PROP_URL] = "URL", [PROP_UID] = "UID",
+  [PROP_EXDATE] = "EXDATE", [PROP_RDATE] = "RDATE", [PROP_RRULE] = "RRULE", [PROP_ACTION] = "ACTION",
+  [PROP_REPEAT] = "REPEAT", [PROP_TRIGGER] = "TRIGGER", [PROP_CREATED] = "CREATED", [PROP_DTSTAMP] = "DTSTAMP",
+  [PROP_LAST_MODIFIED] = "LAST-MODIFIED", [PROP_SEQUENCE] = "SEQUENCE", [PROP_REQUEST_STATUS] = "REQUEST-STATUS"
+};
+
+// Where each known name lands in the hash. The multiplier and size were picked so that no two of the names collide,
+// so a lookup is one hash and one compare. If a name is added they may need to be picked again (Main checks every name)
+#define PROPERTY_KIND_SLOTS 127
+#define PROPERTY_KIND_MULTIPLIER 55
+
+static const unsigned char propertyKindSlots[PROPERTY_KIND_SLOTS] = {
+  [0] = PROP_BEGIN, [5] = PROP_DUE, [10] = PROP_VERSION, [12] = PROP_TZOFFSETTO, [15] = PROP_DTSTAMP,
+  [18] = PROP_PRIORITY, [19] = PROP_TZURL, [20] = PROP_TZID, [26] = PROP_CONTACT, [28] = PROP_FREEBUSY,
+  [31] = PROP_TRANSP, [32] = PROP_ACTION, [34] = PROP_ATTACH, [36] = PROP_SEQUENCE, [38] = PROP_RECURRENCE_ID,
+  [40] = PROP_DTSTART, [43] = PROP_COMPLETED, [45] = PROP_LOCATION, [47] = PROP_DTEND, [49] = PROP_RDATE,
+  [51] = PROP_TRIGGER, [52] = PROP_STATUS, [59] = PROP_DURATION, [62] = PROP_REPEAT, [63] = PROP_CALSCALE,
+  [64] = PROP_ORGANIZER, [70] = PROP_CREATED, [71] = PROP_TZOFFSETFROM, [72] = PROP_METHOD, [74] = PROP_RELATED_TO,
+  [77] = PROP_REQUEST_STATUS, [82] = PROP_GEO, [87] = PROP_RESOURCES, [90] = PROP_ATTENDEE, [91] = PROP_URL,
+  [94] = PROP_DESCRIPTION, [95] = PROP_TZNAME, [96] = PROP_UID, [102] = PROP_COMMENT, [104] = PROP_END,
+  [107] = PROP_LAST_MODIFIED, [108] = PROP_RRULE, [113] = PROP_EXDATE, [114] = PROP_CLASS, [116] = PROP_SUMMARY,
+  [118] = PROP_PRODID, [121] = PROP_PERCENT_COMPLETE, [124] = PROP_CATEGORIES
+};
+
+// Spellings that are not the usual one for their kind (X- names, lowercase names...), shared by every property that
+// uses them. The table stops growing at PROPERTY_NAME_LIMIT names so files full of made up names cannot grow it forever.
+// A property whose spelling is not in it keeps its own copy instead
+#define PROPERTY_NAME_BUCKETS 64
+#define PROPERTY_NAME_LIMIT 1024
+
+typedef struct propertyName {
+  size_t length;
+  struct propertyName* next;
+  char name[];
+} PropertyName;
+
+static PropertyName* propertyNames[PROPERTY_NAME_BUCKETS];
+static size_t propertyNameCount;
+static pthread_rwlock_t propertyNamesLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Hashes a property name the same way regardless of case, for the propertyKindSlots table
+unsigned int hashPropertyName(const char* name, size_t length) {
+  uint32_t hash = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = name[i];
+    if (c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A'; // Names are not case sensitive
+    }
+    hash = hash * PROPERTY_KIND_MULTIPLIER + c;
+  }
+  return hash % PROPERTY_KIND_SLOTS;
+}
 
-  calculateLineLength(&lineLength, " CALENDAR EVENT: \n" , NULL); // Add the length of these strings to the lineLength
-  updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+// Returns the kind of property with this name (ignoring case), or PROP_OTHER if it is not one we know
+PropertyKind getPropertyKind(const char* name, size_t length) {
+  PropertyKind kind = propertyKindSlots[hashPropertyName(name, length)];
+  const char* known = propertyKindNames[kind];
+  if (kind != PROP_OTHER && strncasecmp(name, known, length) == 0 && known[length] == '\0') {
+    return kind;
+  }
+  return PROP_OTHER;
+}
 
-  // UID: some uid\n
-  if (strlen(event->UID) == 0) {
+// Returns the usual spelling of a kind of property
+const char* getPropertyKindName(PropertyKind kind) {
+  if (kind <= PROP_OTHER || kind >= PROP_KIND_COUNT) {
+    return "";
+  }
+  return propertyKindNames[kind];
+}
+
+// Hashes a property name the same way regardless of case, for tables of names that are not known kinds
+static size_t foldedNameHash(const char* name, size_t length) {
+  size_t hash = 5381;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = name[i];
+    if (c >= 'a' && c <= 'z') {
+      c -= 'a' - 'A';
+    }
+    hash = hash * 33 + c;
+  }
+  return hash;
+}
+
+// Returns the interned copy of a spelling from its bucket, or NULL. The lock must be held
+static PropertyName* findPropertyNameEntry(size_t bucket, const char* name, size_t length) {
+  PropertyName* entry = propertyNames[bucket];
+  while (entry && (entry->length != length || memcmp(entry->name, name, length) != 0)) {
+    entry = entry->next;
+  }
+  return entry;
+}
+
+/** Function to intern the name of a property
+  Returns a string that every property with the same name can point to, and sets kind to what the name is (ignoring
+  case). The usual spelling of a known name is returned straight from propertyKindNames, anything else comes from a
+  table (shared safely between threads) that it is added to the first time it is seen.
+  Returns NULL if the spelling is not in the table and cannot be added, because it is full or out of memory
+*/
+const char* internPropertyName(const char* name, size_t length, PropertyKind* kind) {
+  *kind = getPropertyKind(name, length);
+  if (*kind != PROP_OTHER && strncmp(name, propertyKindNames[*kind], length) == 0) {
+    return propertyKindNames[*kind]; // Spelled the usual way
+  }
+
+  size_t bucket = foldedNameHash(name, length) % PROPERTY_NAME_BUCKETS;
+  pthread_rwlock_rdlock(&propertyNamesLock);
+  PropertyName* entry = findPropertyNameEntry(bucket, name, length);
+  pthread_rwlock_unlock(&propertyNamesLock);
+  if (entry) {
+    return entry->name; // Seen it before
+  }
+
+  pthread_rwlock_wrlock(&propertyNamesLock);
+  entry = findPropertyNameEntry(bucket, name, length); // Someone else may have added it while we were waiting for the lock
+  if (!entry && propertyNameCount < PROPERTY_NAME_LIMIT && (entry = malloc(sizeof(PropertyName) + length + 1))) {
+    entry->length = length;
+    memcpy(entry->name, name, length);
+    entry->name[length] = '\0';
+    entry->next = propertyNames[bucket];
+    propertyNames[bucket] = entry;
+    propertyNameCount ++;
+  }
+  pthread_rwlock_unlock(&propertyNamesLock);
+  return entry ? entry->name : NULL;
+}
+
+// Frees every interned name. Only call this once no properties are left
+void clearPropertyNames() {
+  pthread_rwlock_wrlock(&propertyNamesLock);
+  for (size_t i = 0; i < PROPERTY_NAME_BUCKETS; i++) {
+    PropertyName* entry = propertyNames[i];
+    while (entry) {
+      PropertyName* next = entry->next;
+      free(entry);
+      entry = next;
+    }
+    propertyNames[i] = NULL;
+  }
+  propertyNameCount = 0;
+  pthread_rwlock_unlock(&propertyNamesLock);
+}
+
+// An optional index over a property list by name. Known names are found by their kind and any other name by its
+// interned spelling, so finding the properties with a name never compares strings. The list keeps it up to date
+#define PROPERTY_INDEX_BUCKETS 64
+#define PROPERTY_INDEX_MIN_LENGTH 32 // Lists this long are indexed when they are read
+
+typedef struct propertyIndexEntry {
+  int count;
+  int capacity;
+  Property** properties; // In the order they are in the list
+  const char* name; // For names that are not a known kind, as the first property with it spelled it. Matched ignoring case
+  struct propertyIndexEntry* next;
+} PropertyIndexEntry;
+
+typedef struct propertyIndex {
+  ListIndex hooks; // What the list calls. Has to come first
+  Arena* arena; // Same as the list's
+  PropertyIndexEntry kinds[PROP_KIND_COUNT];
+  PropertyIndexEntry* others[PROPERTY_INDEX_BUCKETS];
+  int otherCount; // Properties in others, of every name
+} PropertyIndex;
+
+// Returns the entry for a kind of property, or for a name if it is PROP_OTHER. Adds the entry if create is set
+static PropertyIndexEntry* getPropertyIndexEntry(PropertyIndex* index, PropertyKind kind, const char* name, int create) {
+  if (kind != PROP_OTHER) {
+    return &index->kinds[kind];
+  }
+  size_t length = strlen(name);
+  size_t bucket = foldedNameHash(name, length) % PROPERTY_INDEX_BUCKETS;
+  PropertyIndexEntry* entry = index->others[bucket];
+  while (entry && strcasecmp(entry->name, name) != 0) {
+    entry = entry->next;
+  }
+  if (!entry && create && (entry = arenaCalloc(index->arena, sizeof(PropertyIndexEntry) + length + 1))) {
+    entry->name = memcpy(entry + 1, name, length + 1); // Its own copy, since the property it came from can go
+    entry->next = index->others[bucket];
+    index->others[bucket] = entry;
+  }
+  return entry;
+}
+
+// Returns the entry for the property with room for one more in it, or NULL if there was no room
+static PropertyIndexEntry* reservePropertyIndexEntry(PropertyIndex* index, const Property* p) {
+  PropertyIndexEntry* entry = getPropertyIndexEntry(index, p->kind, p->propName, 1);
+  if (!entry) {
     return NULL;
   }
+  if (entry->count == entry->capacity) { // Double it, the same as a vector list
+    int capacity = entry->capacity ? entry->capacity * 2 : 4;
+    Property** properties = arenaAlloc(index->arena, sizeof(Property*) * capacity);
+    if (!properties) {
+      return NULL;
+    }
+    if (entry->count) {
+      memcpy(properties, entry->properties, sizeof(Property*) * entry->count);
+    }
+    if (!index->arena) {
+      free(entry->properties);
+    }
+    entry->properties = properties;
+    entry->capacity = capacity;
+  }
+  return entry;
+}
 
-  calculateLineLength(&lineLength, "  UID: ", event->UID, "\n" , NULL); // Add the length of these strings to the lineLength
-  updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+static void propertyIndexAdded(ListIndex* hooks, const List* list, void* data) {
+  PropertyIndex* index = (PropertyIndex*) hooks;
+  Property* p = (Property*) data;
+  PropertyIndexEntry* entry = reservePropertyIndexEntry(index, p);
+  if (!entry) {
+    return;
+  }
+  index->otherCount += p->kind == PROP_OTHER;
+  if (getFromBack(*list) == p) {
+    entry->properties[entry->count ++] = p; // Went in after everything else, which is how lists are usually built
+    return;
+  }
+  entry->count = 0; // Went in somewhere in the middle, so find where it is among the others with its name
+  ListIterator iter = createIterator(*list);
+  Property* other;
+  while ((other = nextElement(&iter)) != NULL) {
+    if (other->kind == p->kind && (p->kind != PROP_OTHER || strcasecmp(other->propName, p->propName) == 0)) {
+      entry->properties[entry->count ++] = other;
+    }
+  }
+}
 
-  // CREATION TIMESTAMP: some time\n
-  char* dtString = printDatePretty(event->creationDateTime);
-  calculateLineLength(&lineLength, "  CREATION TIMESTAMP: ", dtString, "\n" , NULL); // Add the length of these strings to the lineLength
-  safelyFreeString(dtString);
-  updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+static void propertyIndexRemoved(ListIndex* hooks, void* data) {
+  PropertyIndex* index = (PropertyIndex*) hooks;
+  Property* p = (Property*) data;
+  PropertyIndexEntry* entry = getPropertyIndexEntry(index, p->kind, p->propName, 0);
+  for (int i = entry ? entry->count - 1 : -1; i >= 0; i--) { // From the back, which is where removed properties usually are
+    if (entry->properties[i] == p) {
+      memmove(entry->properties + i, entry->properties + i + 1, sizeof(Property*) * (entry->count - i - 1));
+      entry->count --;
+      index->otherCount -= p->kind == PROP_OTHER;
+      return;
+    }
+  }
+}
 
-  List alarms = event->alarms;
-  if (alarms.head) {
-    ListIterator alarmIterator = createIterator(alarms);
+static void propertyIndexCleared(ListIndex* hooks) {
+  PropertyIndex* index = (PropertyIndex*) hooks;
+  for (int kind = 0; kind < PROP_KIND_COUNT; kind++) {
+    index->kinds[kind].count = 0;
+  }
+  for (int bucket = 0; bucket < PROPERTY_INDEX_BUCKETS; bucket++) {
+    for (PropertyIndexEntry* entry = index->others[bucket]; entry; entry = entry->next) {
+      entry->count = 0; // Keep the entries, the same names are likely to come back
+    }
+  }
+  index->otherCount = 0;
+}
 
-    Alarm* a;
-    while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
-      calculateLineLength(&lineLength, "  ALARM: \n" , NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+/** Function to index a list of properties by name
+  From now on the list keeps the index up to date through every insert, delete and clear.
+  The index lives in the list's arena if it has one, otherwise it is freed by unindexPropertyList
+*/
+void indexPropertyList(List* list) {
+  if (list->index) {
+    return; // Already indexed
+  }
+  PropertyIndex* index = arenaCalloc(list->arena, sizeof(PropertyIndex));
+  if (!index) {
+    return;
+  }
+  index->hooks = (ListIndex) { &propertyIndexAdded, &propertyIndexRemoved, &propertyIndexCleared };
+  index->arena = list->arena;
+  ListIterator iter = createIterator(*list);
+  Property* p;
+  while ((p = nextElement(&iter)) != NULL) { // Index what is already there, which is in list order to begin with
+    PropertyIndexEntry* entry = reservePropertyIndexEntry(index, p);
+    if (entry) {
+      entry->properties[entry->count ++] = p;
+      index->otherCount += p->kind == PROP_OTHER;
+    }
+  }
+  list->index = &index->hooks;
+}
 
-      if (strlen(a->action) == 0) {
-        return NULL; // Action is empty return null
-      }
-      // Get the length of the Action line
-      calculateLineLength(&lineLength, "    ACTION: ", a->action, "\n" , NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+/** Function to index a property list that was just read, if it is long enough for an index to pay off.
+  Validation counts the kinds of every list and lookups find properties by name, which on a short list
+  is a scan of a few properties and not worth the memory of an index
+*/
+void indexLongPropertyList(List* list) {
+  if (getLength(*list) >= PROPERTY_INDEX_MIN_LENGTH) {
+    indexPropertyList(list);
+  }
+}
 
-      if (strlen(a->trigger) == 0) {
-        return NULL; // Action is empty return null
-      }
-      // Get the length of the Trigger line
-      calculateLineLength(&lineLength, "    TRIGGER: ", a->trigger ,"\n" , NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-      List alarmProps = a->properties;
-      // Output the props
-      if (alarmProps.head) {
-        calculateLineLength(&lineLength, "    ALARM PROPERTIES: \n" , NULL); // Add the length of these strings to the lineLength
-        updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-
-        // Get length of each property
-        ListIterator propsIter = createIterator(alarmProps);
-        Property* p;
-
-        while ((p = nextElement(&propsIter)) != NULL) {
-          char* printedProp = printPropertyListFunction(p); // Get the string for this prop
-          calculateLineLength(&lineLength, "      ", printedProp, "\n", NULL); // Add the length of these strings to the lineLength
-          updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-          safelyFreeString(printedProp); // Free the string
-        }
-      }
+// Stops indexing a list of properties and frees the index
+void unindexPropertyList(List* list) {
+  PropertyIndex* index = (PropertyIndex*) list->index;
+  if (!index) {
+    return;
+  }
+  list->index = NULL;
+  if (index->arena) {
+    return; // freeArena takes care of it
+  }
+  for (int kind = 0; kind < PROP_KIND_COUNT; kind++) {
+    free(index->kinds[kind].properties);
+  }
+  for (int bucket = 0; bucket < PROPERTY_INDEX_BUCKETS; bucket++) {
+    PropertyIndexEntry* entry = index->others[bucket];
+    while (entry) {
+      PropertyIndexEntry* next = entry->next;
+      free(entry->properties);
+      free(entry);
+      entry = next;
     }
   }
+  free(index);
+}
 
-  List propsList = event->properties;
-  if (propsList.head) {
+// Returns the index entry for the properties with this name, or NULL if there are none. The list must be indexed
+static PropertyIndexEntry* findPropertyIndexEntry(List props, const char* name) {
+  return getPropertyIndexEntry((PropertyIndex*) props.index, getPropertyKind(name, strlen(name)), name, 0);
+}
 
-    calculateLineLength(&lineLength, "    EVENT PROPERTIES: \n", NULL); // Add the length of these strings to the lineLength
-    updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
+// Returns 1 if the property has the name. Names are not case sensitive, and known ones are compared by their kind
+static int propertyHasName(const Property* p, PropertyKind kind, const char* name) {
+  return kind != PROP_OTHER ? p->kind == kind : strcasecmp(p->propName, name) == 0;
+}
+
+// Returns how many properties in the list have the name. O(1) if the list is indexed
+int countPropertiesNamed(List props, const char* name) {
+  if (props.index) {
+    PropertyIndexEntry* entry = findPropertyIndexEntry(props, name);
+    return entry ? entry->count : 0;
+  }
+  PropertyKind kind = getPropertyKind(name, strlen(name));
+  int count = 0;
+  ListIterator iter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&iter)) != NULL) {
+    count += propertyHasName(p, kind, name);
+  }
+  return count;
+}
 
-    // Get length of each property
-    ListIterator propsIter = createIterator(propsList);
-    Property* p;
-    while ((p = nextElement(&propsIter)) != NULL) {
-      char* printedProp = printPropertyListFunction(p); // Get the string for this prop
-      calculateLineLength(&lineLength, "    ", printedProp, "\n", NULL); // Add the length of these strings to the lineLength
-      updateLongestLineAndIncrementStringSize(&longestLine, &lineLength, &stringSize); // Update the variable that stores the line with the greatest length
-      safelyFreeString(printedProp); //  Free the string
+// Returns the first property in the list with the name, or NULL. O(1) if the list is indexed
+Property* findPropertyNamed(List props, const char* name) {
+  if (props.index) {
+    PropertyIndexEntry* entry = findPropertyIndexEntry(props, name);
+    return entry && entry->count ? entry->properties[0] : NULL;
+  }
+  PropertyKind kind = getPropertyKind(name, strlen(name));
+  ListIterator iter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&iter)) != NULL) {
+    if (propertyHasName(p, kind, name)) {
+      return p;
     }
   }
+  return NULL;
+}
 
-  char* string = malloc(stringSize + 1);
+// Returns every property in an indexed list with the name, in list order, and sets count. NULL if there are none
+// or the list is not indexed. The array belongs to the index and is only good until the list changes
+Property** getPropertiesNamed(List props, const char* name, int* count) {
+  PropertyIndexEntry* entry = props.index ? findPropertyIndexEntry(props, name) : NULL;
+  *count = entry ? entry->count : 0;
+  return *count ? entry->properties : NULL;
+}
 
-  concatenateLine(string, " CALENDAR EVENT: \n", NULL);
-  // UID: some uid\n
-  concatenateLine(string, "   UID: ", event->UID, "\n", NULL);
-  // CREATION TIMESTAMP: some time\n
-  dtString = printDatePretty(event->creationDateTime);
-  concatenateLine(string, "  CREATION TIMESTAMP: ", dtString, "\n", NULL);
-  safelyFreeString(dtString);
+// An index over a list of events by UID. Each bucket is a chain in the order the events were added, so the first
+// event added with a UID is the one that is found. Removed entries are kept to be reused
+#define EVENT_INDEX_MIN_BUCKETS 64
 
-  alarms = event->alarms;
-  if (alarms.head) {
-    ListIterator alarmIterator = createIterator(alarms);
+typedef struct eventIndexEntry {
+  Event* event;
+  unsigned int hash; // Of the UID, to skip most string compares
+  struct eventIndexEntry* next;
+} EventIndexEntry;
+
+typedef struct eventIndex {
+  ListIndex hooks; // What the list calls. Has to come first
+  Arena* arena; // Same as the list's
+  EventIndexEntry** buckets;
+  int bucketCount; // A power of two
+  int count;
+  EventIndexEntry* spare;
+} EventIndex;
+
+// FNV-1a of a UID
+static unsigned int hashEventUID(const char* UID) {
+  unsigned int hash = 2166136261u;
+  for (const unsigned char* c = (const unsigned char*) UID; *c; c++) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  return hash;
+}
 
-    Alarm* a;
-    while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
-      concatenateLine(string, "  ALARM: \n", NULL); // Alarm header
-      concatenateLine(string, "    ACTION: ", a->action, "\n", NULL); // Alarm action
-      concatenateLine(string, "    TRIGGER: ", a->trigger, "\n", NULL); // Alarm trigger
-
-      List alarmProps = a->properties;
-      // Output the props
-      if (alarmProps.head) {
-        concatenateLine(string, "    ALARM PROPERTIES: \n", NULL); // Alarm properties header
-
-        // Get each property string
-        ListIterator propsIter = createIterator(alarmProps);
-        Property* p;
-
-        while ((p = nextElement(&propsIter)) != NULL) {
-          char* printedProp = printPropertyListFunction(p);
-          concatenateLine(string, "      ", printedProp, "\n", NULL); // Alarm properties
-          safelyFreeString(printedProp); // Free the string
-        }
+// Puts an entry on the end of its bucket's chain
+static void appendEventIndexEntry(EventIndexEntry** buckets, int bucketCount, EventIndexEntry* entry) {
+  EventIndexEntry** link = &buckets[entry->hash & (bucketCount - 1)];
+  while (*link) {
+    link = &(*link)->next;
+  }
+  entry->next = NULL;
+  *link = entry;
+}
+
+// Makes a bigger table and moves the chains over without changing their order. Returns 0 if there was no memory
+static int resizeEventIndex(EventIndex* index, int bucketCount) {
+  EventIndexEntry** buckets = arenaCalloc(index->arena, sizeof(EventIndexEntry*) * bucketCount);
+  if (!buckets) {
+    return 0;
+  }
+  for (int bucket = 0; bucket < index->bucketCount; bucket++) {
+    EventIndexEntry* entry = index->buckets[bucket];
+    while (entry) {
+      EventIndexEntry* next = entry->next;
+      appendEventIndexEntry(buckets, bucketCount, entry);
+      entry = next;
+    }
+  }
+  if (!index->arena) {
+    free(index->buckets);
+  }
+  index->buckets = buckets;
+  index->bucketCount = bucketCount;
+  return 1;
+}
+
+static void eventIndexAdded(ListIndex* hooks, const List* list, void* data) {
+  EventIndex* index = (EventIndex*) hooks;
+  if (index->count >= index->bucketCount && !resizeEventIndex(index, index->bucketCount * 2)) {
+    return;
+  }
+  EventIndexEntry* entry = index->spare;
+  if (entry) {
+    index->spare = entry->next;
+  } else if (!(entry = arenaAlloc(index->arena, sizeof(EventIndexEntry)))) {
+    return;
+  }
+  entry->event = (Event*) data;
+  entry->hash = hashEventUID(getEventUID(entry->event));
+  appendEventIndexEntry(index->buckets, index->bucketCount, entry);
+  index->count ++;
+}
+
+// Unlinks the entry for the event from a chain. Returns 1 if it was there
+static int unlinkEventIndexEntry(EventIndex* index, EventIndexEntry** link, const Event* event) {
+  for (; *link; link = &(*link)->next) {
+    if ((*link)->event == event) {
+      EventIndexEntry* entry = *link;
+      *link = entry->next;
+      entry->next = index->spare;
+      index->spare = entry;
+      index->count --;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void eventIndexRemoved(ListIndex* hooks, void* data) {
+  EventIndex* index = (EventIndex*) hooks;
+  unsigned int hash = hashEventUID(getEventUID((Event*) data));
+  if (unlinkEventIndexEntry(index, &index->buckets[hash & (index->bucketCount - 1)], data)) {
+    return;
+  }
+  for (int bucket = 0; bucket < index->bucketCount; bucket++) { // Its UID was set without changeEventUID
+    if (unlinkEventIndexEntry(index, &index->buckets[bucket], data)) {
+      return;
+    }
+  }
+}
+
+static void eventIndexCleared(ListIndex* hooks) {
+  EventIndex* index = (EventIndex*) hooks;
+  for (int bucket = 0; bucket < index->bucketCount; bucket++) {
+    while (index->buckets[bucket]) {
+      EventIndexEntry* entry = index->buckets[bucket];
+      index->buckets[bucket] = entry->next;
+      entry->next = index->spare;
+      index->spare = entry;
+    }
+  }
+  index->count = 0;
+}
+
+/** Function to index a list of events by UID
+  From now on the list keeps the index up to date through every insert, delete and clear.
+  The index lives in the list's arena if it has one, otherwise it is freed by unindexEventList
+*/
+void indexEventList(List* list) {
+  if (list->index) {
+    return; // Already indexed
+  }
+  EventIndex* index = arenaCalloc(list->arena, sizeof(EventIndex));
+  if (!index) {
+    return;
+  }
+  index->hooks = (ListIndex) { &eventIndexAdded, &eventIndexRemoved, &eventIndexCleared };
+  index->arena = list->arena;
+  int bucketCount = EVENT_INDEX_MIN_BUCKETS;
+  while (bucketCount < getLength(*list)) {
+    bucketCount *= 2; // Big enough that adding what is already there never resizes
+  }
+  if (!resizeEventIndex(index, bucketCount)) {
+    if (!index->arena) {
+      free(index);
+    }
+    return;
+  }
+  ListIterator iter = createIterator(*list);
+  Event* event;
+  while ((event = nextElement(&iter)) != NULL) {
+    eventIndexAdded(&index->hooks, list, event);
+  }
+  list->index = &index->hooks;
+}
+
+// Stops indexing a list of events and frees the index
+void unindexEventList(List* list) {
+  EventIndex* index = (EventIndex*) list->index;
+  if (!index) {
+    return;
+  }
+  list->index = NULL;
+  if (index->arena) {
+    return; // freeArena takes care of it
+  }
+  eventIndexCleared(&index->hooks); // Everything ends up spare
+  while (index->spare) {
+    EventIndexEntry* next = index->spare->next;
+    free(index->spare);
+    index->spare = next;
+  }
+  free(index->buckets);
+  free(index);
+}
+
+// Returns the first event added to an indexed list with the UID, or NULL if there is none
+Event* findIndexedEvent(List events, const char* UID) {
+  EventIndex* index = (EventIndex*) events.index;
+  if (!index) {
+    return NULL;
+  }
+  unsigned int hash = hashEventUID(UID);
+  for (EventIndexEntry* entry = index->buckets[hash & (index->bucketCount - 1)]; entry; entry = entry->next) {
+    if (entry->hash == hash && strcmp(getEventUID(entry->event), UID) == 0) {
+      return entry->event;
+    }
+  }
+  return NULL;
+}
+
+// Counts how many properties of each kind are in the list
+void countPropertyKinds(List props, int counts[PROP_KIND_COUNT]) {
+  if (props.index) {
+    PropertyIndex* index = (PropertyIndex*) props.index;
+    for (int kind = 0; kind < PROP_KIND_COUNT; kind++) {
+      counts[kind] = index->kinds[kind].count; // Already counted
+    }
+    counts[PROP_OTHER] = index->otherCount;
+    return;
+  }
+  memset(counts, 0, sizeof(int) * PROP_KIND_COUNT);
+  ListIterator propIter = createIterator(props);
+  Property* prop;
+  while ((prop = nextElement(&propIter))) {
+    counts[prop->kind] ++;
+  }
+}
+
+// The scanners below accept exactly what their regular expressions (in the comments) accept in the C locale
+
+// Returns 1 if c is allowed in a TEXT value (no control characters, '"', '\', ',', ':' or ';')
+int isTEXTChar(unsigned char c) {
+  return c >= 0x20 && c != 0x7f && c != '"' && c != '\\' && c != ',' && c != ':' && c != ';';
+}
+
+// ^(;|:){0,1}[^[:cntrl:]"\,:;]+$
+int matchTEXTField(const char* line) {
+  const unsigned char* c = (const unsigned char*) line;
+  if (*c == ';' || *c == ':') {
+    c ++; // Skip the optional (semi)colon
+  }
+  if (!*c) {
+    return 0; // Need at least one character
+  }
+  for (; *c; c++) {
+    if (!isTEXTChar(*c)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// [^[:cntrl:]"\:;]+$ (not anchored at the start, so only the last character matters)
+int matchSUMMARYField(const char* line) {
+  size_t length = strlen(line);
+  if (length == 0) {
+    return 0;
+  }
+  unsigned char last = line[length - 1];
+  return isTEXTChar(last) || last == ',';
+}
+
+// (:|;){0,1}[[:digit:]]{8}T[[:digit:]]{6}Z{0,1}$ (not anchored at the start and case insensitive)
+int matchDATEField(const char* line) {
+  size_t length = strlen(line);
+  if (length > 0 && (line[length - 1] == 'Z' || line[length - 1] == 'z')) {
+    length --; // Optional UTC marker
+  }
+  if (length < 15) {
+    return 0; // Too short for YYYYMMDDThhmmss
+  }
+  const char* date = line + length - 15;
+  for (size_t i = 0; i < 15; i++) {
+    if (i == 8) {
+      if (date[i] != 'T' && date[i] != 't') {
+        return 0;
       }
+    } else if (date[i] < '0' || date[i] > '9') {
+      return 0;
     }
   }
+  return 1;
+}
 
-  // EVENT PROPERTIES: \n
-  propsList = event->properties;
-  if (propsList.head) {
-    concatenateLine(string, "  EVENT PROPERTIES: \n", NULL); // Event properties header
+// States of the URI scanner. Each bit is one position in the URI regular expression
+enum uriState { URI_SCHEME, URI_SLASH, URI_TAIL, URI_USER, URI_USER_COLON, URI_PASSWORD, URI_HOST, URI_NAME, URI_NAME_DOT,
+  URI_DOMAIN, URI_IP_OCTET1, URI_IP_OCTET2, URI_IP_OCTET3, URI_IP_DOT1, URI_IP_PART1, URI_IP_DOT2, URI_IP_PART2, URI_IP_DOT3,
+  URI_IP_PART3, URI_HOST_END, URI_PORT_COLON, URI_PORT, URI_PORT_END, URI_PATH_SLASH, URI_PATH, URI_PATH_END, URI_EXT_DOT,
+  URI_EXT, URI_END };
+
+#define URI_BIT(state) (1u << (state))
+
+// Adds the states that can be reached without consuming a character
+unsigned int uriClosure(unsigned int states) {
+  if (states & URI_BIT(URI_TAIL)) {
+    states |= URI_BIT(URI_HOST); // The user info is optional
+  }
+  if (states & (URI_BIT(URI_NAME) | URI_BIT(URI_DOMAIN) | URI_BIT(URI_IP_PART3))) {
+    states |= URI_BIT(URI_HOST_END);
+  }
+  if (states & (URI_BIT(URI_HOST_END) | URI_BIT(URI_PORT))) {
+    states |= URI_BIT(URI_PORT_END); // The port is optional
+  }
+  if (states & (URI_BIT(URI_PORT_END) | URI_BIT(URI_PATH) | URI_BIT(URI_PATH_END) | URI_BIT(URI_EXT))) {
+    states |= URI_BIT(URI_END); // The path and extensions are optional
+  }
+  return states;
+}
 
-    // print each property
-    ListIterator propsIter = createIterator(propsList);
-    Property* p;
+// Moves every active state of the URI scanner over the character c
+unsigned int uriStep(unsigned int states, unsigned char c) {
+  int digit = c >= '0' && c <= '9';
+  int alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+  int alnum = digit || alpha;
+  unsigned int next = 0;
 
-    while ((p = nextElement(&propsIter)) != NULL) {
-      char* printedProp = printPropertyListFunction(p);
-      concatenateLine(string, "   ", printedProp, "\n", NULL); // Event properties
-      safelyFreeString(printedProp);
+  if (alpha) {
+    next |= URI_BIT(URI_SCHEME); // A match can start at any letter
+  }
+  if ((states & URI_BIT(URI_SCHEME)) && (alnum || (c >= '+' && c <= ':') || c == '\\')) {
+    next |= URI_BIT(URI_SCHEME);
+  }
+  if ((states & URI_BIT(URI_SCHEME)) && c == '/') {
+    next |= URI_BIT(URI_SLASH);
+  }
+  if ((states & URI_BIT(URI_SLASH)) && c == '/') {
+    next |= URI_BIT(URI_TAIL);
+  }
+  if ((states & (URI_BIT(URI_TAIL) | URI_BIT(URI_USER))) && alnum) {
+    next |= URI_BIT(URI_USER);
+  }
+  if ((states & URI_BIT(URI_USER)) && c == ':') {
+    next |= URI_BIT(URI_USER_COLON);
+  }
+  if (states & (URI_BIT(URI_USER_COLON) | URI_BIT(URI_PASSWORD))) {
+    next |= URI_BIT(URI_PASSWORD); // Anything goes in the password
+  }
+  if ((states & URI_BIT(URI_PASSWORD)) && c == '@') {
+    next |= URI_BIT(URI_HOST);
+  }
+  if ((states & (URI_BIT(URI_HOST) | URI_BIT(URI_NAME))) && alnum) {
+    next |= URI_BIT(URI_NAME);
+  }
+  if ((states & URI_BIT(URI_NAME)) && c == '.') {
+    next |= URI_BIT(URI_NAME_DOT);
+  }
+  if ((states & (URI_BIT(URI_NAME_DOT) | URI_BIT(URI_DOMAIN))) && alpha) {
+    next |= URI_BIT(URI_DOMAIN);
+  }
+  if (digit) {
+    if (states & URI_BIT(URI_HOST)) {
+      next |= URI_BIT(URI_IP_OCTET1);
+    }
+    if (states & URI_BIT(URI_IP_OCTET1)) {
+      next |= URI_BIT(URI_IP_OCTET2);
+    }
+    if (states & URI_BIT(URI_IP_OCTET2)) {
+      next |= URI_BIT(URI_IP_OCTET3);
+    }
+    if (states & (URI_BIT(URI_IP_DOT1) | URI_BIT(URI_IP_PART1))) {
+      next |= URI_BIT(URI_IP_PART1);
+    }
+    if (states & (URI_BIT(URI_IP_DOT2) | URI_BIT(URI_IP_PART2))) {
+      next |= URI_BIT(URI_IP_PART2);
+    }
+    if (states & (URI_BIT(URI_IP_DOT3) | URI_BIT(URI_IP_PART3))) {
+      next |= URI_BIT(URI_IP_PART3);
+    }
+    if (states & (URI_BIT(URI_PORT_COLON) | URI_BIT(URI_PORT))) {
+      next |= URI_BIT(URI_PORT);
+    }
+  }
+  if (c == '.') {
+    if (states & (URI_BIT(URI_IP_OCTET1) | URI_BIT(URI_IP_OCTET2) | URI_BIT(URI_IP_OCTET3))) {
+      next |= URI_BIT(URI_IP_DOT1);
+    }
+    if (states & URI_BIT(URI_IP_PART1)) {
+      next |= URI_BIT(URI_IP_DOT2);
+    }
+    if (states & (URI_BIT(URI_IP_PART2) | URI_BIT(URI_IP_PART3))) {
+      next |= URI_BIT(URI_IP_DOT3); // Three or more parts after the first octet
+    }
+    if (states & URI_BIT(URI_END)) {
+      next |= URI_BIT(URI_EXT_DOT);
     }
   }
-  return string;
+  if ((states & URI_BIT(URI_HOST_END)) && c == ':') {
+    next |= URI_BIT(URI_PORT_COLON);
+  }
+  if ((states & URI_BIT(URI_PORT_END)) && c == '/') {
+    next |= URI_BIT(URI_PATH_SLASH);
+  }
+  if ((states & (URI_BIT(URI_PATH_SLASH) | URI_BIT(URI_PATH) | URI_BIT(URI_PATH_END))) && (alnum || c == '-')) {
+    next |= URI_BIT(URI_PATH);
+  }
+  if ((states & URI_BIT(URI_PATH)) && c == '/') {
+    next |= URI_BIT(URI_PATH_END);
+  }
+  if ((states & (URI_BIT(URI_EXT_DOT) | URI_BIT(URI_EXT))) && alnum) {
+    next |= URI_BIT(URI_EXT);
+  }
+  return uriClosure(next);
 }
 
-char* printPropertyListFunction(void *toBePrinted) {
-  Property* p = (Property*) toBePrinted;
-  size_t finalSize = 0;
-  char c;
-  size_t i = 0;
-  while ((c = p->propName[i]) != '\0') {
-    i ++; // Calculate length of the prop name
+// [[:alpha:]][[:alnum:]+-:\.]*//([[:alnum:]]+:.+@){0,1}([[:alnum:]]+(\.[[:alpha:]]+){0,1}|[[:digit:]]{1,3}(\.[[:digit:]]+){3,})
+//   (:[[:digit:]]+){0,1}(/([[:alnum:]-]+/{0,1})+){0,1}(\.[[:alnum:]]+)*$ (not anchored at the start)
+int matchURIField(const char* line) {
+  unsigned int states = 0;
+  for (const unsigned char* c = (const unsigned char*) line; *c; c++) {
+    states = uriStep(states, *c);
+  }
+  return (states & URI_BIT(URI_END)) != 0;
+}
+
+// ^[^[:cntrl:]"\,:;]+(,[^[:cntrl:]"\,:;]+)*$
+int matchTEXTListField(const char* line) {
+  int needText = 1; // Every item in the list must have at least one character
+  for (const unsigned char* c = (const unsigned char*) line; *c; c++) {
+    if (*c == ',') {
+      if (needText) {
+        return 0;
+      }
+      needText = 1;
+    } else if (isTEXTChar(*c)) {
+      needText = 0;
+    } else {
+      return 0;
+    }
+  }
+  return !needText;
+}
+
+// Scans [\+\-]{0,1}[[:digit:]]+(\.[[:digit:]]+){0,1} and returns a pointer past it, or NULL if it is not there
+const char* scanDecimal(const char* c) {
+  if (*c == '+' || *c == '-' || *c == '\\') {
+    c ++; // Optional sign
+  }
+  if (*c < '0' || *c > '9') {
+    return NULL;
+  }
+  while (*c >= '0' && *c <= '9') {
+    c ++;
+  }
+  if (*c == '.') {
+    c ++;
+    if (*c < '0' || *c > '9') {
+      return NULL; // The fraction needs digits
+    }
+    while (*c >= '0' && *c <= '9') {
+      c ++;
+    }
+  }
+  return c;
+}
+
+// ^[\+\-]{0,1}[[:digit:]]+(\.[[:digit:]]+){0,1};[\+\-]{0,1}[[:digit:]]+(\.[[:digit:]]+){0,1}$
+int matchLONGLATField(const char* line) {
+  const char* c = scanDecimal(line);
+  if (!c || *c != ';') {
+    return 0;
+  }
+  c = scanDecimal(c + 1);
+  return c && *c == '\0';
+}
+
+// [[:alnum:]\.\-]+@[[:alnum:]\-]+\.[[:alnum:]]+(\.[[:alnum:]]+){0,1}$ (not anchored at the start)
+int matchEMAILField(const char* line) {
+  const char* at = strrchr(line, '@'); // Nothing after the domain's @ can be another @
+  if (!at || at == line) {
+    return 0;
+  }
+  char before = at[-1];
+  if (!(before >= '0' && before <= '9') && !(before >= 'a' && before <= 'z') && !(before >= 'A' && before <= 'Z')
+      && before != '.' && before != '-' && before != '\\') {
+    return 0; // The local part needs at least one character
+  }
+
+  int part = 0; // Which dot separated part of the domain we are in
+  size_t partLength = 0;
+  for (const unsigned char* c = (const unsigned char*) at + 1; *c; c++) {
+    if (*c == '.') {
+      if (partLength == 0 || part == 2) {
+        return 0; // Empty part or too many parts
+      }
+      part ++;
+      partLength = 0;
+    } else if ((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z')
+               || (part == 0 && (*c == '-' || *c == '\\'))) {
+      partLength ++;
+    } else {
+      return 0;
+    }
+  }
+  return part >= 1 && partLength > 0;
+}
+
+int matchDURATIONField(const char* line) {
+  return 1;
+  // Second: [[:digit:]]+S
+  // minute: [[:digit:]]+M([[:digit:]]+S){0,1}
+  // hour: [[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}
+  // time: (T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)
+  // day: [[:digit:]]+D
+  // date: [[:digit:]]+D((T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)){0,1}
+  return match(line, "([\\+-]{0,1}P([[:digit:]]+D((T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)){0,1}|(T[[:digit:]]+H([[:digit:]]+M([[:digit:]]+S){0,1}){0,1}|T[[:digit:]]+M([[:digit:]]+S){0,1}|T[[:digit:]]+S)|[[:digit:]]+W)|(:|;){0,1}[[:digit:]]{8}T[[:digit:]]{6}Z{0,1})$");
+}
+
+// Check if the string is allocated before freeing it
+void safelyFreeString(char* c) {
+  if (c) {
+    free(c);
+  }
+}
+
+// Returns a copy of value (in the arena if there is one) to replace field with, and frees field unless the arena owns it
+char* replaceField(Arena* arena, char* field, const char* value) {
+  char* copy = NULL;
+  if (value) {
+    size_t length = strlen(value);
+    copy = arenaAlloc(arena, length + 1);
+    memcpy(copy, value, length + 1); // Copy first in case value is the field itself
+  }
+  if (field && !arenaOwns(arena, field)) {
+    free(field);
+  }
+  return copy;
+}
+
+void deleteEventListFunction(void* toBeDeleted) {
+  Event* event = (Event*) toBeDeleted;
+  if (event != NULL) { // If there is an event
+    List* props = &event->properties; // Grab the props
+    if (props) { // If there are props
+      clearList(props); // Set them free
+      unindexPropertyList(props);
+    }
+    List* alarms = &event->alarms; // Grab the alarms
+    if (alarms) { // If the alarms exist
+      clearList(alarms); // Set them free
+    }
+    safelyFreeString(event->UID); // Free the UID if it was set
+    free(event); // Set it free
   }
-  finalSize += i; // add it to the total
-  i = 0; // reset
-  while ((c = p->propDescr[i]) != '\0') {
-    i ++; // Calculate length of description
+}
+
+char* printEventListFunction(void *toBePrinted) {
+  Event* event = (Event*) toBePrinted;
+
+  // UID: some uid\n
+  if (strlen(getEventUID(event)) == 0) {
+    return NULL;
   }
-  finalSize += i; // add it up again
-  if (p->propDescr[0] != ';' && p->propDescr[0] != ':') {
-    finalSize ++;
+
+  StringBuilder string = initializeStringBuilder(0);
+  appendString(&string, " CALENDAR EVENT: \n");
+  appendStrings(&string, "   UID: ", getEventUID(event), "\n", NULL);
+  // CREATION TIMESTAMP: some time\n
+  appendString(&string, "  CREATION TIMESTAMP: ");
+  appendDate(&string, event->creationDateTime);
+  appendString(&string, "\n");
+
+  loadEvent(event); // Decodes an event from createCalendarLazy
+  ListIterator alarmIterator = createIterator(event->alarms);
+  Alarm* a;
+  while ((a = nextElement(&alarmIterator)) != NULL) { // Loop through each alarm
+    if (strlen(getAlarmAction(a)) == 0 || strlen(a->trigger) == 0) {
+      freeStringBuilder(&string);
+      return NULL; // Action or trigger is empty return null
+    }
+    appendString(&string, "  ALARM: \n"); // Alarm header
+    appendStrings(&string, "    ACTION: ", getAlarmAction(a), "\n", NULL); // Alarm action
+    appendStrings(&string, "    TRIGGER: ", a->trigger, "\n", NULL); // Alarm trigger
+    if (getFromFront(a->properties)) {
+      appendString(&string, "    ALARM PROPERTIES: \n"); // Alarm properties header
+      appendPropertyLines(&string, a->properties, "      ");
+    }
   }
-  char* string = calloc(finalSize + 1, 1); // +1 to make room for NULL terminator
-  strcpy(string, p->propName);
-  if (p->propDescr[0] != ';' && p->propDescr[0] != ':') {
-    strcat(string, ":");
+
+  // EVENT PROPERTIES: \n
+  if (getFromFront(event->properties)) {
+    appendString(&string, "  EVENT PROPERTIES: \n"); // Event properties header
+    appendPropertyLines(&string, event->properties, "   ");
   }
-  strcat(string, p->propDescr);
-  string[finalSize] = '\0'; // Set null terminator just in case strcat didnt
-  return string;
+  return finishString(&string);
+}
+
+char* printPropertyListFunction(void *toBePrinted) {
+  Property* p = (Property*) toBePrinted;
+  StringBuilder string = initializeStringBuilder(strlen(p->propName) + strlen(p->propDescr) + 2); // Room for all of it
+  appendProperty(&string, p);
+  return finishString(&string);
 }
 
 int compareEventListFunction(const void *first, const void *second) {
   Event* e1 = (Event*) first;
   Event* e2 = (Event*) second;
-  char* s1 = e1->UID;
-  char* s2 = e2->UID;
-  int result = strcmp(s1, s2); // Compare the strings
+	return strcmp(getEventUID(e1), getEventUID(e2)); // Compare the UIDs. They belong to the events so nothing to free
+}
 
-  safelyFreeString(s1); // BECAUSE I'M FREEEEE!!!!! FREE FALLIN'
-  safelyFreeString(s2);
-	return result; // Return the result
+// Orders events by their DTSTAMP, for keeping them in a sorted list. The date and time are fixed width digits so strcmp orders them
+int compareEventCreationTimes(const void *first, const void *second) {
+  const DateTime* dt1 = &((const Event*) first)->creationDateTime;
+  const DateTime* dt2 = &((const Event*) second)->creationDateTime;
+  int compare = strcmp(dt1->date, dt2->date);
+  return compare ? compare : strcmp(dt1->time, dt2->time);
 }
 
+// Compares two properties the same way strcmp would compare their printed lines, without printing them
 int comparePropertyListFunction(const void *first, const void *second) {
-  char* s1 = printPropertyListFunction((void*)first); // Print each prop
-  char* s2 = printPropertyListFunction((void*)second);
-  int result = strcmp(s1, s2); // Compare the strings
+  const Property* p1 = (const Property*) first;
+  const Property* p2 = (const Property*) second;
+  const char* parts1[] = {p1->propName, printedSeparator(p1), p1->propDescr}; // What the printed lines are made of
+  const char* parts2[] = {p2->propName, printedSeparator(p2), p2->propDescr};
+  int part1 = 0;
+  int part2 = 0;
+  const char* c1 = parts1[0];
+  const char* c2 = parts2[0];
+
+  while (1) {
+    while (!*c1 && part1 < 2) {
+      c1 = parts1[++part1]; // Move on to the next part of the first line
+    }
+    while (!*c2 && part2 < 2) {
+      c2 = parts2[++part2];
+    }
+    if (*c1 != *c2 || !*c1) {
+      return (unsigned char) *c1 - (unsigned char) *c2; // Return the result
+    }
+    c1 ++;
+    c2 ++;
+  }
+}
 
-  safelyFreeString(s1); // BECAUSE I'M FREEEEE!!!!! FREE FALLIN'
-  safelyFreeString(s2);
-	return result; // Return the result
+// Returns what goes between the name and the description when a property is printed
+const char* printedSeparator(const Property* p) {
+  if (getPropertyParameterCount(p) > 0) {
+    return ";"; // The parameters come straight after the name
+  }
+  if (p->propDescr[0] == ';' || p->propDescr[0] == ':') {
+    return ""; // The description brings its own
+  }
+  return ":";
 }
 
 void deletePropertyListFunction(void *toBeDeleted) {
@@ -1020,37 +2062,15 @@ void deletePropertyListFunction(void *toBeDeleted) {
 // This method never gets called but whatev
 char* printAlarmListFunction(void *toBePrinted) {
   Alarm* a = (Alarm*) toBePrinted;
-  size_t finalSize = 0;
-  char c;
-  size_t i = 0;
-  while ((c = a->action[i]) != '\0') {
-    i ++; // Calculate size of action
-  }
-  finalSize += i;
-  i = 0;
-  while ((c = a->trigger[i]) != '\0') {
-    i ++; // Calculate size of trigger
-  }
-  finalSize += i;
-  finalSize += 4; // Add room for "|"
   char* propListString = toString(a->properties); // Print the properties
-  i = 0;
-  while ((c = propListString[i]) != '\0') {
-    i ++; // Calculate size of list string
+  if (!propListString) {
+    return NULL;
   }
-  finalSize += i;
   // Mash it all up together
-  char* string = malloc(finalSize + 1); // +1 to make room for NULL terminator
-  strcpy(string, "|");
-  strcat(string, a->action);
-  strcat(string, "|");
-  strcat(string, a->trigger);
-  strcat(string, "|");
-  strcat(string, propListString);
-  strcat(string, "|");
-  string[finalSize] = '\0'; // Set null terminator just in case strcat didnt
+  StringBuilder string = initializeStringBuilder(0);
+  appendStrings(&string, "|", getAlarmAction(a), "|", a->trigger, "|", propListString, "|", NULL);
   safelyFreeString(propListString); // Bye felicia
-  return string; // Return the string
+  return finishString(&string); // Return the string
 }
 
 // This hasnt been required yet
@@ -1072,31 +2092,240 @@ void deleteAlarmListFunction(void *toBeDeleted) {
   if (a->trigger) {
     free(a->trigger); // Free trigger if it exists
   }
+  safelyFreeString(a->action); // Free action if it was set
   clearList(&a->properties); // Clear properties
+  unindexPropertyList(&a->properties);
 	free(a); // Bye
 }
 
 Property* createProperty(char* propName, char* propDescr) {
-  Property* p = calloc(sizeof(Property) + strlen(propDescr)*sizeof(char*) + 1 /* this 1 is to make room for null terminator */ + strlen(propName), 1); // Allocate room for the property and the flexible array member
-  strcpy(p->propName, propName); // Copy prop name over
-  p->propDescr[0] = '\0';
-  strcpy(p->propDescr, propDescr); // Copy prop description over
-  return p; // Send it back
+  return createPropertyFromView(propName, strlen(propName), propDescr, strlen(propDescr), 0, NULL);
+}
+
+// Returns 1 if c can be part of a parameter name
+static int isParameterNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+}
+
+/** Picks the parameters out of a description written as param=value;param=value:value. Values can be
+  quoted, which lets them hold ':', ';' and ',', and can be lists separated by commas.
+  Fills in params if it is not NULL and sets valueOffset to where the property's value starts
+  @return the number of parameters, or 0 if the description is not parameters followed by a value
+*/
+unsigned int scanPropertyParameters(const char* descr, size_t length, PropertyParameter* params, unsigned int* valueOffset) {
+  unsigned int count = 0;
+  size_t i = 0;
+  while (1) {
+    size_t nameStart = i;
+    while (i < length && isParameterNameChar(descr[i])) {
+      i ++;
+    }
+    if (i == nameStart || i == length || descr[i] != '=') {
+      return 0; // Every parameter needs a name and a value
+    }
+    size_t nameEnd = i ++;
+
+    size_t valueStart = i;
+    int values = 0;
+    int quoted = 0; // Set if the only value is in quotes
+    do {
+      if (values ++ > 0) {
+        i ++; // Past the comma
+      }
+      if (i < length && descr[i] == '"') {
+        const char* close = memchr(descr + i + 1, '"', length - i - 1);
+        if (!close) {
+          return 0; // The quotes were never closed
+        }
+        i = close - descr + 1;
+        quoted = values == 1;
+      } else {
+        while (i < length && descr[i] != ';' && descr[i] != ':' && descr[i] != ',' && descr[i] != '"') {
+          i ++;
+        }
+        quoted = 0;
+      }
+    } while (i < length && descr[i] == ',');
+    if (i == length || (descr[i] != ';' && descr[i] != ':')) {
+      return 0; // A value has to end in the next parameter or the property's value
+    }
+
+    if (params) {
+      PropertyParameter* param = &params[count];
+      param->nameOffset = nameStart;
+      param->nameLength = nameEnd - nameStart;
+      param->valueOffset = valueStart + quoted;
+      param->valueLength = i - valueStart - 2 * quoted; // Without the quotes around a single quoted value
+    }
+    count ++;
+    if (descr[i ++] == ':') {
+      *valueOffset = i;
+      return count;
+    }
+  }
+}
+
+// Returns the size of a property with a description of this length and, if it has a parameter table, this many
+// parameters, and where in it the table starts
+static size_t propertySize(size_t descrLength, int withParameters, unsigned int paramCount, size_t* paramsStart) {
+  size_t alignment = _Alignof(PropertyParameters);
+  *paramsStart = (sizeof(Property) + descrLength + 1 + alignment - 1) / alignment * alignment; // After the null terminator
+  if (!withParameters) {
+    return sizeof(Property) + descrLength + 1; // Nothing after the description
+  }
+  return *paramsStart + sizeof(PropertyParameters) + paramCount * sizeof(PropertyParameter);
+}
+
+// Returns the parameter table of the property, or NULL if its name was not followed by ';'
+static const PropertyParameters* propertyParameters(const Property* p) {
+  return p->paramsOffset ? (const PropertyParameters*) ((const char*) p + p->paramsOffset) : NULL;
+}
+
+// Returns the size of the property's own copy of its name, which goes after the rest of it (bodySize bytes), or 0 if
+// its name is interned
+static size_t inlineNameSize(const Property* p, size_t bodySize) {
+  return p->propName == (const char*) p + bodySize ? strlen(p->propName) + 1 : 0;
+}
+
+// Makes room for a property that is getting bigger, moving its own copy of its name to the new end. Returns the
+// (possibly moved) property
+static Property* growProperty(Property* p, size_t oldSize, size_t newSize, Arena* arena) {
+  size_t nameSize = inlineNameSize(p, oldSize);
+  if (arenaOwns(arena, p)) { // Arena memory cannot grow so move it to a bigger spot. Folded lines are rare enough
+    Property* bigger = arenaAlloc(arena, newSize + nameSize);
+    memcpy(bigger, p, oldSize + nameSize);
+    p = bigger;
+  } else {
+    p = realloc(p, newSize + nameSize);
+  }
+  if (p && nameSize > 0) {
+    p->propName = memmove((char*) p + newSize, (char*) p + oldSize, nameSize);
+  }
+  return p;
+}
+
+// Picks the parameters out of the description and puts the table after it, making room if the property only has
+// room for fewer. Returns the (possibly moved) property
+static Property* placeParameters(Property* p, size_t descrLength, int withParameters, unsigned int room, Arena* arena) {
+  p->paramsOffset = 0;
+  if (!withParameters) {
+    return p; // The whole description is the value
+  }
+  unsigned int valueOffset = 0;
+  unsigned int count = scanPropertyParameters(p->propDescr, descrLength, NULL, &valueOffset);
+  size_t paramsStart;
+  size_t size = propertySize(descrLength, 1, count, &paramsStart);
+  if (count > room) {
+    p = growProperty(p, propertySize(descrLength, 1, room, &paramsStart), size, arena);
+  }
+  PropertyParameters* params = (PropertyParameters*) ((char*) p + paramsStart);
+  params->count = count;
+  params->valueOffset = count > 0 ? valueOffset : 0; // Parameters that cannot be read are part of the value
+  if (count > 0) {
+    scanPropertyParameters(p->propDescr, descrLength, params->params, &valueOffset); // Scanned again now that there is somewhere to put them
+  }
+  p->paramsOffset = paramsStart;
+  return p;
+}
+
+/** Creates a property, in the arena if there is one, from a name and a description that are not null terminated (eg. they point into a mapped file).
+  If withParameters is set the description is what came after NAME; and its parameters are picked out
+*/
+Property* createPropertyFromView(const char* propName, size_t nameLength, const char* propDescr, size_t descrLength, int withParameters, Arena* arena) {
+  unsigned int valueOffset;
+  unsigned int paramCount = withParameters ? scanPropertyParameters(propDescr, descrLength, NULL, &valueOffset) : 0;
+  size_t paramsStart;
+  size_t size = propertySize(descrLength, withParameters, paramCount, &paramsStart); // Room for the property, the flexible array member (+1 for null terminator) and the parameters
+  PropertyKind kind;
+  const char* name = internPropertyName(propName, nameLength, &kind); // The name is shared, only the description is copied
+  Property* p = arenaAlloc(arena, name ? size : size + nameLength + 1); // Or the property gets its own copy at the end
+  if (!p) {
+    return NULL;
+  }
+  if (!name) {
+    char* copy = (char*) p + size;
+    memcpy(copy, propName, nameLength);
+    copy[nameLength] = '\0';
+    name = copy;
+  }
+  p->propName = name;
+  p->kind = kind;
+  memcpy(p->propDescr, propDescr, descrLength); // Copy prop description over
+  p->propDescr[descrLength] = '\0';
+  return placeParameters(p, descrLength, withParameters, paramCount, arena); // Already has room for them
+}
+
+// Appends n chars of c onto the description of the property. Returns the (possibly moved) property. A folded line can finish off the parameters, so they are picked out again
+Property* appendToProperty(Property* p, const char* c, size_t n, Arena* arena) {
+  size_t descrLength = strlen(p->propDescr);
+  const PropertyParameters* params = propertyParameters(p);
+  int withParameters = params != NULL;
+  unsigned int room = params ? params->count : 0; // Read before the new chars go over the table
+  size_t paramsStart;
+  size_t oldSize = propertySize(descrLength, withParameters, room, &paramsStart);
+  p = growProperty(p, oldSize, propertySize(descrLength + n, withParameters, room, &paramsStart), arena); // Make room for the new chars
+  memcpy(p->propDescr + descrLength, c, n);
+  p->propDescr[descrLength + n] = '\0';
+  return placeParameters(p, descrLength + n, withParameters, room, arena);
+}
+
+// Returns a copy of the property, in the arena if there is one. The name and description are copied straight over, never printed and parsed again
+Property* copyProperty(const Property* p, Arena* arena) {
+  const PropertyParameters* params = propertyParameters(p);
+  size_t paramsStart;
+  size_t size = propertySize(strlen(p->propDescr), params != NULL, params ? params->count : 0, &paramsStart); // Room for the property, its flexible array member and its parameters
+  size_t nameSize = inlineNameSize(p, size);
+  Property* copy = arenaAlloc(arena, size + nameSize);
+  if (!copy) {
+    return NULL;
+  }
+  memcpy(copy, p, size + nameSize); // The interned name can be shared, and the table is found by its offset
+  if (nameSize > 0) {
+    copy->propName = (char*) copy + size; // Its own copy of the name came along
+  }
+  return copy;
+}
+
+const char* getPropertyValue(const Property* p) {
+  const PropertyParameters* params = propertyParameters(p);
+  return params ? p->propDescr + params->valueOffset : p->propDescr;
+}
+
+const char* getPropertyParameter(const Property* p, const char* name, size_t* length) {
+  const PropertyParameters* params = propertyParameters(p);
+  size_t nameLength = strlen(name);
+  for (unsigned int i = 0; params && i < params->count; i ++) {
+    const PropertyParameter* param = &params->params[i];
+    if (param->nameLength == nameLength && strncasecmp(p->propDescr + param->nameOffset, name, nameLength) == 0) {
+      *length = param->valueLength;
+      return p->propDescr + param->valueOffset;
+    }
+  }
+  return NULL;
+}
+
+unsigned int getPropertyParameterCount(const Property* p) {
+  const PropertyParameters* params = propertyParameters(p);
+  return params ? params->count : 0;
 }
 
 Alarm* createAlarm(char* action, char* trigger, List properties) {
   if (!action || !trigger) {
     return NULL; // If the action or trigger is null then nothing can save you
   }
-  Alarm* alarm = calloc(sizeof(Alarm), 1);
+  Alarm* alarm = arenaCalloc(properties.arena, sizeof(Alarm)); // The alarm lives wherever its properties do
+  alarm->properties = properties; // Set the properties first so the action goes in the same place
   if (action[0] == ':' || action[0] == ';') { // Remove the beginning ; or : if it exists
     memmove(action, action + 1, strlen(action));
   }
-  strcpy(alarm->action, action); // Copy the action
-  alarm->trigger = calloc(strlen(trigger) + 1, 1); // Allocate room for trigger
+  setAlarmAction(alarm, action); // Copy the action
+  alarm->trigger = arenaCalloc(properties.arena, strlen(trigger) + 1); // Allocate room for trigger
 
   if (!alarm->trigger) {
-    free(alarm); // Free alarm before returning
+    if (!arenaOwns(properties.arena, alarm)) {
+      safelyFreeString(alarm->action); // The action was malloced along with the alarm
+    }
+    arenaDelete(properties.arena, alarm, &free); // Free alarm before returning
     return NULL; // If we were unable to allocate memory
   }
 
@@ -1104,14 +2333,13 @@ Alarm* createAlarm(char* action, char* trigger, List properties) {
     memmove(trigger, trigger + 1, strlen(trigger));
   }
   strcpy(alarm->trigger, trigger); // Copy trigger
-  alarm->properties = properties; // Set the properties
 
   return alarm; // Send it back
 }
 
 Alarm* createAlarmFromPropList(List props) {
   // Create a list for the props
-  List alarmProps = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  List alarmProps = initializeListInArena(props.arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
 
   char* ACTION = NULL; // Declare action and trigger
   char* TRIGGER = NULL;
@@ -1120,38 +2348,37 @@ Alarm* createAlarmFromPropList(List props) {
   ListIterator propsIterator = createIterator(props); // Do I really need to re-iterate myself here?
 
   while ((prop = nextElement(&propsIterator)) != NULL) {
-    char* propName = prop->propName; // Get name
+    const char* propName = prop->propName; // Get name
     char* propDescr = prop->propDescr; // Get description
 
     if (strcmp(propDescr, "") == 0 || strcmp(propName, "") == 0) { // If no descripting, we are in trouble
       clearList(&alarmProps); // Clear before returning
       return NULL; // Bye
     }
-    char tempDescription[strlen(propDescr) + 2]; //
-    strcpy(tempDescription, propDescr);
-    if (match(tempDescription, "^(;|:)")) {
-      memmove(tempDescription, tempDescription+1, strlen(tempDescription)); // remove the first character as it is (; or :)
+    const char* value = getPropertyValue(prop);
+    if (getPropertyParameterCount(prop) == 0 && (value[0] == ';' || value[0] == ':')) {
+      value ++; // Skip the first character as it is (; or :)
     }
-    if (match(propName, "^ACTION$")) {
-      if (ACTION || !match(tempDescription, "^(AUDIO|DISPLAY|EMAIL)$")) {
+    if (prop->kind == PROP_ACTION) {
+      if (ACTION || !match(value, "^(AUDIO|DISPLAY|EMAIL)$")) {
         clearList(&alarmProps);
         return NULL; // Already have an ACTION or description is null
       }
-      ACTION = malloc(strlen(tempDescription) + 1);
-      strcpy(ACTION, tempDescription);
+      ACTION = malloc(strlen(value) + 1);
+      strcpy(ACTION, value);
 
-    } else if (match(propName, "^TRIGGER$")) {
-      if (TRIGGER || !matchDURATIONField(propDescr)) {
+    } else if (prop->kind == PROP_TRIGGER) {
+      if (TRIGGER || !matchDURATIONField(value)) {
         clearList(&alarmProps);
         // printf("%s\n", propDescr);
         return NULL; // Already have trigger
       } else {
-        TRIGGER = malloc(strlen(tempDescription) + 1);
-        strcpy(TRIGGER, tempDescription);
+        const char* trigger = getPropertyParameterCount(prop) > 0 ? prop->propDescr : value; // Keeps parameters like VALUE=DATE-TIME, which change what the trigger means
+        TRIGGER = malloc(strlen(trigger) + 1);
+        strcpy(TRIGGER, trigger);
       }
     } else {
-      Property* p = createProperty(propName, propDescr);
-      insertBack(&alarmProps, p);
+      insertBack(&alarmProps, copyProperty(prop, props.arena));
     }
   }
 
@@ -1161,13 +2388,14 @@ Alarm* createAlarmFromPropList(List props) {
     safelyFreeString(TRIGGER);
     return NULL;
   }
+  indexLongPropertyList(&alarmProps);
   Alarm* a = createAlarm(ACTION, TRIGGER, alarmProps);
   safelyFreeString(ACTION);
   safelyFreeString(TRIGGER);
   return a;
 }
 
-char* extractSubstringBefore(char* line, char* terminator) {
+char* extractSubstringBefore(const char* line, char* terminator) {
 
   if (!line || !terminator) { // If the line is NULL return null
     return NULL;
@@ -1188,7 +2416,7 @@ char* extractSubstringBefore(char* line, char* terminator) {
 }
 
 
-char* extractSubstringAfter(char* line, char* terminator) {
+char* extractSubstringAfter(const char* line, char* terminator) {
   if (!line || !terminator) { // If the line is NULL return null
     return NULL;
   }
@@ -1208,36 +2436,54 @@ char* extractSubstringAfter(char* line, char* terminator) {
 }
 
 Property* extractPropertyFromLine(char* line) {
-  size_t lineLength = strlen(line);
-  char tempLine[lineLength + 1];
-  strcpy(tempLine, line);
-  char* propName = strtok(line, ":;");
-  char* temp;
-  size_t descriptionLength = 0;
-  while ((temp = strtok(NULL, ";:"))) {
-    descriptionLength += strlen(temp);
-    descriptionLength += 1; // strtok removes the ';'
-  }
-  // descriptionLength += 1; // strtok removes the ';'
-  char propDescr[descriptionLength + 1];
-  size_t substring = lineLength - descriptionLength;
-  if (match(&tempLine[substring], "^(;|:)")) {
-    memcpy(propDescr, tempLine + substring + 1, descriptionLength);
-  } else {
-    memcpy(propDescr, tempLine + substring, descriptionLength);
+  return extractPropertyFromView(line, strlen(line), NULL);
+}
+
+/** Extracts a property from a line that is not null terminated.
+  The name is the first run of characters that are not ':' or ';' and the description is
+  everything after the delimiter that follows it
+*/
+Property* extractPropertyFromView(const char* line, size_t length, Arena* arena) {
+  size_t i = 0;
+  while (i < length && (line[i] == ':' || line[i] == ';')) {
+    i ++; // Skip any delimiters in front of the name
+  }
+  size_t nameStart = i;
+  while (i < length && line[i] != ':' && line[i] != ';') {
+    i ++; // The name runs until the first delimiter
+  }
+  size_t nameLength = i - nameStart;
+
+  // The description starts one character further in for every repeated delimiter and for a trailing delimiter
+  size_t descrStart = i;
+  int previousWasDelimiter = 0;
+  for (; i < length; i++) {
+    int isDelimiter = line[i] == ':' || line[i] == ';';
+    if (isDelimiter && previousWasDelimiter) {
+      descrStart ++;
+    }
+    previousWasDelimiter = isDelimiter;
   }
-  propDescr[descriptionLength] = '\0';
-  Property* p = createProperty(propName, propDescr);
-  return p;
+  if (previousWasDelimiter) {
+    descrStart ++;
+  }
+  int withParameters = 0; // Set if the name was followed by ; and the description is not just more delimiters
+  if (descrStart < length && (line[descrStart] == ':' || line[descrStart] == ';')) {
+    withParameters = line[descrStart] == ';' && descrStart == nameStart + nameLength;
+    descrStart ++; // Dont include the delimiter itself
+  }
+  return createPropertyFromView(line + nameStart, nameLength, line + descrStart, length - descrStart, withParameters, arena);
 }
 
 /**
   *Takes a file that has been opened and reads the lines into a linked list of chars*
   *with each node being one line of the file.
+  *Folded lines are joined while they are read, so every complete line is handed straight
+  *to the property extractor without going through an intermediate file.
   *@param: file
   * The file to be read. Note the file must be open
   *@param: bufferSize
-  * The maximum size of each line
+  * The initial size of the buffer holding the line being unfolded (it grows as needed)
   *@return: list
   * The list with each line read into it
 */
@@ -1252,194 +2498,649 @@ ICalErrorCode readLinesIntoList(char* fileName, List* list, int bufferSize) {
   char * line = NULL;
   size_t len = 0;
   ssize_t read;
-  char prevLine[bufferSize * 10];
-  strcpy(prevLine, "");
-  FILE* tempFile = fopen("temp.ics", "w+");
+  size_t capacity = bufferSize > 0 ? bufferSize : 512;
+  size_t unfoldedLength = 0;
+  char* unfoldedLine = malloc(capacity); // Holds the line we are currently unfolding
+  unfoldedLine[0] = '\0';
+  ICalErrorCode error = OK;
 
   while ((read = getline(&line, &len, file)) != -1) {
-    if (match(line, "^;.*\n\r$")) { // Line ending
+    if (isFoldedLine(line, read)) { // if this line starts with a space or tab and isnt blank
+      if (unfoldedLength >= 2 && unfoldedLine[unfoldedLength - 1] == '\n' && unfoldedLine[unfoldedLength - 2] == '\r') {
+        unfoldedLength -= 2; // Remove the line ending from the line we are continuing
+      }
+      appendToLine(&unfoldedLine, &unfoldedLength, &capacity, line + 1, read - 1); // Join it without the leading space
       continue;
     }
-    if (match(line, "^[[:blank:]]+.+")) { // if this line starts with a space or tab and isnt blank
-      if (prevLine[strlen(prevLine) - 1] == '\n') { // Remove new line from end of line
-        if ((int)strlen(prevLine) - 2 >= 0 && prevLine[strlen(prevLine) - 2] == '\r') { // Remove carriage return if it exists
-          prevLine[strlen(prevLine) - 2] = '\0';
+
+    // This line starts a new property so the previous one is complete
+    if (unfoldedLength > 0 && (error = parseUnfoldedLine(unfoldedLine, unfoldedLength, list)) != OK) {
+      break;
+    }
+    unfoldedLength = 0;
+    appendToLine(&unfoldedLine, &unfoldedLength, &capacity, line, read);
+  }
+  if (error == OK && unfoldedLength > 0) {
+    error = parseUnfoldedLine(unfoldedLine, unfoldedLength, list); // Dont forget the last line
+  }
+  safelyFreeString(unfoldedLine);
+  safelyFreeString(line);
+  fclose(file);
+
+  if (error != OK) {
+    return error;
+  }
+  if (!getFromFront(*list)) {
+    return INV_CAL; // If the file was empty
+  }
+  return OK;
+}
+
+/**
+  *Memory maps the file and tokenizes it in place into a list of properties.
+  *Produces exactly the same list and errors as readLinesIntoList
+  *@param: fileName
+  * The name of the file to be read
+  *@return: list
+  * The list with each line read into it
+*/
+ICalErrorCode readMappedLinesIntoList(char* fileName, List* list, const PropertyFilter* filter) {
+  int fd;
+  struct stat fileStat;
+  // If the fileName is NULL or does not match the regex expression *.ics or cannot be opened
+  if (!fileName || !match(fileName, ".+\\.ics$") || (fd = open(fileName, O_RDONLY)) == -1) {
+    return INV_FILE; // The file is invalid
+  }
+  if (fstat(fd, &fileStat) == -1 || !S_ISREG(fileStat.st_mode)) {
+    close(fd);
+    return INV_FILE;
+  }
+  if (fileStat.st_size == 0) {
+    close(fd);
+    return INV_CAL; // If the file was empty
+  }
+
+  size_t length = fileStat.st_size;
+  char* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping stays valid after the descriptor is closed
+  if (mapping == MAP_FAILED) {
+    return INV_FILE;
+  }
+  madvise(mapping, length, MADV_SEQUENTIAL); // We only ever read front to back
+
+  ICalErrorCode error = readBufferIntoList(mapping, length, list, filter);
+  munmap(mapping, length);
+  return error;
+}
+
+/**
+  *Tokenizes a buffer holding the contents of an iCalendar file into a list of properties.
+  *Lines are handled as views into the buffer and are only copied when they have to be unfolded
+  *@param: buffer
+  * The contents of the file. It does not have to be null terminated
+  *@param: length
+  * The number of bytes in the buffer
+  *@param: filter
+  * The properties to keep, or NULL to keep all of them
+  *@return: list
+  * The list with each line read into it
+*/
+ICalErrorCode readBufferIntoList(const char* buffer, size_t length, List* list, const PropertyFilter* filter) {
+  ICalErrorCode error = unfoldBufferIntoList(buffer, length, list, filter);
+  if (error != OK) {
+    return error;
+  }
+  if (!getFromFront(*list)) {
+    return INV_CAL; // If the file was empty
+  }
+  return OK;
+}
+
+// Does the work of readBufferIntoList. A buffer with no properties in it is fine here
+ICalErrorCode unfoldBufferIntoList(const char* buffer, size_t length, List* list, const PropertyFilter* filter) {
+  const char* unfoldedLine = NULL; // The line we are currently unfolding
+  size_t unfoldedLength = 0;
+  int skipping = 0; // Set while going past the lines of a property the filter leaves out
+  char* foldedCopy = NULL; // Only used if the current line has continuations
+  size_t foldedLength = 0;
+  size_t capacity = 0;
+  ICalErrorCode error = OK;
+
+  size_t position = 0;
+  while (position < length) {
+    const char* line = buffer + position;
+    const char* newLine = memchr(line, '\n', length - position);
+    size_t lineLength = newLine ? (size_t)(newLine - line) + 1 : length - position;
+    position += lineLength;
+
+    if (skipping && newLine && (lineLength < 2 || line[lineLength - 2] != '\r')) {
+      error = INV_FILE; // Skipped lines are still only allowed to end in CRLF
+      break;
+    }
+    if (isFoldedLine(line, lineLength)) { // if this line starts with a space or tab and isnt blank
+      if (skipping) {
+        continue; // Nothing is copied for a property that is left out
+      }
+      if (!foldedCopy) {
+        capacity = 512;
+        foldedCopy = malloc(capacity);
+      }
+      if (unfoldedLine != foldedCopy) { // First continuation so we need our own copy of the line
+        foldedLength = 0;
+        if (unfoldedLength > 0) {
+          appendToLine(&foldedCopy, &foldedLength, &capacity, unfoldedLine, unfoldedLength);
         }
       }
-      memmove(line, line + 1, strlen(line)); // Shift the contents of the string right by one as to not include the space
-      strcat(prevLine, line);
+      if (foldedLength >= 2 && foldedCopy[foldedLength - 1] == '\n' && foldedCopy[foldedLength - 2] == '\r') {
+        foldedLength -= 2; // Remove the line ending from the line we are continuing
+      }
+      appendToLine(&foldedCopy, &foldedLength, &capacity, line + 1, lineLength - 1); // Join it without the leading space
+      unfoldedLine = foldedCopy;
+      unfoldedLength = foldedLength;
+      continue;
+    }
+
+    // This line starts a new property so the previous one is complete
+    if (unfoldedLength > 0 && (error = parseUnfoldedLine(unfoldedLine, unfoldedLength, list)) != OK) {
+      break;
+    }
+    const char* next = buffer + position;
+    if (skipping && (line[0] == '\r' || line[0] == '\n') && isFoldedLine(next, length - position) && (next[1] == ' ' || next[1] == '\t')) {
+      continue; // A blank line whose continuation starts with another space adds onto the property being skipped
+    }
+    skipping = filter && !propertyFilterKeeps(filter, line, lineLength);
+    if (skipping) {
+      if (newLine && (lineLength < 2 || line[lineLength - 2] != '\r')) {
+        error = INV_FILE;
+        break;
+      }
+      unfoldedLine = NULL;
+      unfoldedLength = 0;
       continue;
     }
+    unfoldedLine = line; // Point straight into the buffer
+    unfoldedLength = lineLength;
+  }
+  if (error == OK && unfoldedLength > 0) {
+    error = parseUnfoldedLine(unfoldedLine, unfoldedLength, list); // Dont forget the last line
+  }
+  safelyFreeString(foldedCopy);
+  return error;
+}
+
+// Properties every calendar needs to be built and validated. A filter always keeps these
+static const PropertyKind requiredPropertyKinds[] = {PROP_BEGIN, PROP_END, PROP_VERSION, PROP_PRODID, PROP_UID, PROP_DTSTAMP, PROP_ACTION, PROP_TRIGGER};
 
-    // write line
-    fputs(prevLine, tempFile);
-    strcpy(prevLine, line);
+void initializePropertyFilter(PropertyFilter* filter, char* const names[], int count) {
+  memset(filter->kinds, 0, sizeof(filter->kinds));
+  for (size_t i = 0; i < sizeof(requiredPropertyKinds) / sizeof(requiredPropertyKinds[0]); i ++) {
+    filter->kinds[requiredPropertyKinds[i]] = 1;
   }
-  fputs(prevLine, tempFile);
-  safelyFreeString(line);
-  fclose(tempFile);
+  filter->others = names;
+  filter->otherCount = count;
+  for (int i = 0; i < count; i ++) {
+    PropertyKind kind = getPropertyKind(names[i], strlen(names[i]));
+    if (kind != PROP_OTHER) {
+      filter->kinds[kind] = 1; // Known names are found by their kind so only the others are compared
+    }
+  }
+}
 
-  file = fopen("temp.ics", "r");
+int propertyFilterKeeps(const PropertyFilter* filter, const char* line, size_t length) {
+  if (line[0] == ';' || !isPropertyLine(line, length)) {
+    return 1; // Comments, and lines whose name is not all there, are left to the tokenizer
+  }
+  size_t nameLength = 0;
+  while (line[nameLength] != ':' && line[nameLength] != ';') {
+    nameLength ++; // isPropertyLine made sure there is one
+  }
+  PropertyKind kind = getPropertyKind(line, nameLength);
+  if (kind != PROP_OTHER) {
+    return filter->kinds[kind];
+  }
+  for (int i = 0; i < filter->otherCount; i ++) {
+    if (strncasecmp(filter->others[i], line, nameLength) == 0 && filter->others[i][nameLength] == '\0') {
+      return 1;
+    }
+  }
+  return 0;
+}
 
-  line = NULL;
-  len = 0;
+/**
+  *Reads the whole of an iCalendar file into a new buffer, which the caller has to free.
+  *Rejects the same files that readMappedLinesIntoList does
+*/
+ICalErrorCode readFileIntoBuffer(char* fileName, char** buffer, size_t* length) {
+  int fd;
+  struct stat fileStat;
+  // If the fileName is NULL or does not match the regex expression *.ics or cannot be opened
+  if (!fileName || !match(fileName, ".+\\.ics$") || (fd = open(fileName, O_RDONLY)) == -1) {
+    return INV_FILE; // The file is invalid
+  }
+  if (fstat(fd, &fileStat) == -1 || !S_ISREG(fileStat.st_mode)) {
+    close(fd);
+    return INV_FILE;
+  }
+  if (fileStat.st_size == 0) {
+    close(fd);
+    return INV_CAL; // If the file was empty
+  }
 
-  while ((read = getline(&line, &len, file)) != -1) {
-    if (match(line, "^;")) {
-      continue; // This is a line comment
+  *length = fileStat.st_size;
+  *buffer = malloc(*length);
+  size_t done = 0;
+  while (*buffer && done < *length) { // One read unless the kernel hands it over in pieces
+    ssize_t got = read(fd, *buffer + done, *length - done);
+    if (got < 0 && errno == EINTR) {
+      continue;
     }
-    if (match(line, "^[[:blank:]]+.+")) { // if this line starts with a space or tab and isnt blank
-      Node* tailNode = list->tail;
-      if (!tailNode) {
-        fclose(file);
-        return INV_CAL; // This is the first line in the list and the first line cannot be a line continuation
-      }
+    if (got <= 0) {
+      break;
+    }
+    done += got;
+  }
+  close(fd);
+  if (!*buffer || done < *length) {
+    safelyFreeString(*buffer);
+    *buffer = NULL;
+    return INV_FILE;
+  }
+  return OK;
+}
 
-      Property* p = (Property*) tailNode->data;
-      if (!p) {
-        fclose(file);
-        return INV_CAL; // Something has gone wrong if the data is null
+/**
+  *Checks the structure of a calendar without tokenizing the lines of its events. Every line is checked the way
+  *readBufferIntoList checks it, but only the calendar's own properties, the component tags and the UID and DTSTAMP
+  *of each event are turned into properties. Each event is left with a loader that decodes the rest of its lines.
+  *Errors are reported in the same order as createCalendarFromLines reports them
+*/
+ICalErrorCode createLazyCalendarFromBuffer(const char* buffer, size_t length, Calendar* calendar) {
+  List lines = initializeListInArena(calendar->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  int calendarState = 0; // 0 before BEGIN:VCALENDAR, 1 inside the calendar and 2 after END:VCALENDAR
+  int calendarBroken = 0; // Set when the calendar tags are out of order
+  int eventsBroken = 0; // Set when the event tags are out of order. No more events are made after that
+  ICalErrorCode eventError = OK; // Error of the first event that could not be made. No more events are made after that either
+  Event* event = NULL; // The event that is currently open
+  size_t eventBegin = 0; // Where the BEGIN:VEVENT line of the open event starts
+  size_t eventStart = 0; // Where the lines of the open event start
+  int inAlarm = 0;
+  Property* UID = NULL; // The open event's UID and DTSTAMP, found outside of its alarms
+  Property* DTSTAMP = NULL;
+  int duplicated = 0; // Set if the open event has more than one of them
+
+  size_t position = 0;
+  while (position < length) {
+    const char* line = buffer + position;
+    size_t lineLength = scanLogicalLine(line, length - position);
+    size_t lineStart = position;
+    position += lineLength;
+
+    ICalErrorCode lineError = OK;
+    const char* firstNewLine = memchr(line, '\n', lineLength);
+    if ((firstNewLine && firstNewLine < line + lineLength - 1) || (lineStart == 0 && isFoldedLine(line, lineLength))) {
+      lineError = unfoldBufferIntoList(line, lineLength, &lines, NULL); // Unfolding can do odd things, so leave it to the tokenizer
+    } else if (line[0] == ';') {
+      continue; // This is a line comment
+    } else if (firstNewLine && (lineLength < 2 || line[lineLength - 2] != '\r')) {
+      lineError = INV_FILE; // Lines must end in CRLF
+    } else if (!isPropertyLine(line, lineLength)) {
+      lineError = INV_CAL;
+    } else {
+      size_t nameLength = 0;
+      while (line[nameLength] != ':' && line[nameLength] != ';') {
+        nameLength ++; // isPropertyLine made sure there is one
+      }
+      PropertyKind kind = getPropertyKind(line, nameLength);
+      if (calendarBroken || calendarState == 2 || (kind != PROP_BEGIN && kind != PROP_END && !(calendarState == 1 && (!event || eventsBroken))
+          && !(event && !inAlarm && (kind == PROP_UID || kind == PROP_DTSTAMP)))) {
+        continue; // Left for the event to decode when it is used, or ignored
       }
+      lineError = parseUnfoldedLine(line, lineLength, &lines);
+    }
+    if (lineError != OK) {
+      clearList(&lines);
+      return lineError; // A malformed line anywhere in the file comes before everything else
+    }
 
-      if (line[strlen(line) - 1] == '\n') { // Remove new line from end of line
-        if ((int)strlen(line) - 2 >= 0 && line[strlen(line) - 2] == '\r') { // Remove carriage return if it exists
-          line[strlen(line) - 2] = '\0';
+    Property* prop;
+    while ((prop = getFromFront(lines)) != NULL) {
+      removeFromList(&lines, prop);
+      int kept = 0; // Set if prop was handed to something
+      if (calendarBroken || calendarState == 2) {
+        // Anything after the calendar is ignored
+      } else if (isComponentTag(prop, PROP_BEGIN, "VCALENDAR")) {
+        calendarBroken = calendarState == 1; // Opened another calendar without closing this one
+        calendarState = 1;
+      } else if (isComponentTag(prop, PROP_END, "VCALENDAR")) {
+        calendarBroken = calendarState == 0; // Closed a calendar without opening one
+        calendarState = 2;
+        if (event && eventError == OK) { // Closed the calendar with an event still open
+          returnLazyEventLines(calendar, event, buffer + eventBegin, lineStart - eventBegin, UID, DTSTAMP);
+          event = NULL;
+          eventsBroken = 1;
         }
-      }
-      memmove(line, line + 1, strlen(line)); // Shift the contents of the string right by one as to not include the space
-      size_t currentSize = sizeof(*p) + strlen(p->propDescr)*sizeof(char) + 1; // Calculatethe current size of the property
-      size_t newSize = currentSize + strlen(line)*sizeof(char); // Calculate how much memory we need for the new property
-      p = (Property*) tailNode->data;
-      // tailNode->data = realloc(p, newSize + 1); // Reallocate memory for the new property
-      p = realloc(p, newSize + 1); // Reallocate memory for new property
-      strcat(p->propDescr, line); // Concat this line onto the property description
-
-      tailNode->data = p;
-      list->tail = tailNode;
-      continue; // Continue to the next line
-    }
-    if (match(line, "(\r\n){0,1}$")) {
-      if (line[strlen(line) - 1] == '\n') { // Remove new line from end of line
-        if ((int)strlen(line) - 2 >= 0 && line[strlen(line) - 2] == '\r') { // Remove carriage return if it exists
-          line[strlen(line) - 2] = '\0';
+      } else if (calendarState == 0 || eventError != OK) {
+        // Anything before the calendar, or after an event that could not be made, is not looked at
+      } else if (eventsBroken) {
+        insertBack(&calendar->properties, prop); // Everything after the events broke stays with the calendar
+        kept = 1;
+      } else if (isComponentTag(prop, PROP_BEGIN, "VEVENT")) {
+        if (event) {
+          returnLazyEventLines(calendar, event, buffer + eventBegin, lineStart - eventBegin, UID, DTSTAMP);
+          event = NULL;
+          insertBack(&calendar->properties, prop);
+          kept = 1;
+          eventsBroken = 1; // Opened another event without closing the previous
+        } else {
+          event = newEmptyEventInArena(calendar->arena);
+          eventBegin = lineStart;
+          eventStart = position;
+          inAlarm = 0;
+          duplicated = 0;
+        }
+      } else if (isComponentTag(prop, PROP_END, "VEVENT")) {
+        if (event) {
+          eventError = finishLazyEvent(calendar, event, buffer + eventStart, lineStart - eventStart, duplicated ? NULL : UID, DTSTAMP);
+          arenaDelete(calendar->arena, UID, &deletePropertyListFunction);
+          arenaDelete(calendar->arena, DTSTAMP, &deletePropertyListFunction);
+          event = NULL;
+          UID = NULL;
+          DTSTAMP = NULL;
         } else {
-          safelyFreeString(line);
-          fclose(file);
-          return INV_FILE;
+          insertBack(&calendar->properties, prop);
+          kept = 1;
+          eventsBroken = 1; // Closed an event without opening one
+        }
+      } else if (event) {
+        if (isComponentTag(prop, PROP_BEGIN, "VALARM")) {
+          inAlarm = 1;
+        } else if (isComponentTag(prop, PROP_END, "VALARM")) {
+          inAlarm = 0;
+        } else if (!inAlarm && (prop->kind == PROP_UID || prop->kind == PROP_DTSTAMP)) {
+          Property** found = prop->kind == PROP_UID ? &UID : &DTSTAMP;
+          if (*found) {
+            duplicated = 1; // The event has two of them
+          } else {
+            *found = prop;
+            kept = 1;
+          }
         }
+      } else {
+        insertBack(&calendar->properties, prop);
+        kept = 1;
+      }
+      if (!kept) {
+        arenaDelete(calendar->arena, prop, &deletePropertyListFunction);
       }
     }
-    if (match(line, "^[a-zA-Z\\-]*(:|;).*$")) {
-      Property* p = extractPropertyFromLine(line);
-      insertBack(list, p); // Insert the property into the list
-    } else {
-      safelyFreeString(line);
-      fclose(file);
-      return INV_CAL;
-      // if (line[strlen(line) - 1] == '\n') { // Remove new line from end of line
-      //   if ((int)strlen(line) - 2 >= 0 && line[strlen(line) - 2] == '\r') { // Remove carriage return if it exists
-      //     line[strlen(line) - 2] = '\0';
-      //   } else {
-      //     safelyFreeString(line);
-      //     fclose(file);
-      //     return INV_FILE;
-      //   }
-      // }
-      // Property* p = createProperty(line, "");
-      // insertBack(list, p); // Insert the property into the list
-    }
-  }
-  remove("temp.ics");
-  safelyFreeString(line);
-  fclose(file);
-  if (!list->head) {
-    return INV_CAL; // If the file was empty
   }
-  return OK;
+
+  if (event) { // The last event was never closed
+    arenaDelete(calendar->arena, UID, &deletePropertyListFunction);
+    arenaDelete(calendar->arena, DTSTAMP, &deletePropertyListFunction);
+    arenaDelete(calendar->arena, event, &deleteEventListFunction);
+  }
+  if (calendarBroken || calendarState != 2) {
+    return INV_CAL; // The calendar was missing, unclosed or nested
+  }
+
+  ICalErrorCode error = eventError;
+  if (error == OK && !getFromFront(calendar->events)) {
+    error = INV_CAL; // If there is no event, then the calendar is invalid
+  }
+  if (error == OK) {
+    error = parseRequirediCalTags(&calendar->properties, calendar);
+    indexLongPropertyList(&calendar->properties);
+  }
+  if (error == OK && eventsBroken) { // The lines of broken events were left in the calendar, which validateCalendar checks after the events
+    error = validateCalendar(calendar);
+    error = error != OK ? error : INV_CAL;
+  }
+  if (error != OK) {
+    ListIterator eventIterator = createIterator(calendar->events);
+    while ((event = nextElement(&eventIterator)) != NULL) {
+      ICalErrorCode loadError = loadEvent(event); // createCalendarFromLines makes every event before it checks the rest
+      if (loadError != OK) {
+        return loadError;
+      }
+    }
+  }
+  return error;
 }
 
-void deleteProperty(List* propList, char* line) {
-  char temp[strlen(line) + 1]; // Make a temp variable that is allocated because extractPropertyFromLine uses strtok which cannot use a non existant memory address
-  strcpy(temp, line);
-  Property* p = extractPropertyFromLine(temp);
-  safelyFreeString(deleteDataFromList(propList, p));
-  free(p);
+/**
+  *Returns the length of the line at the start of the buffer together with its continuations.
+  *A blank line is taken too if its continuation starts with another space, since readBufferIntoList then adds the
+  *continuation onto the line before it
+*/
+size_t scanLogicalLine(const char* buffer, size_t length) {
+  size_t position = 0;
+  do {
+    const char* newLine = memchr(buffer + position, '\n', length - position);
+    position = newLine ? (size_t)(newLine - buffer) + 1 : length;
+    const char* next = buffer + position;
+    size_t blankLength = position < length && next[0] == '\n' ? 1 : (position + 1 < length && next[0] == '\r' && next[1] == '\n' ? 2 : 0);
+    const char* continuation = next + blankLength;
+    if (blankLength > 0 && isFoldedLine(continuation, length - position - blankLength) && (continuation[1] == ' ' || continuation[1] == '\t')) {
+      position += blankLength;
+    }
+  } while (position < length && isFoldedLine(buffer + position, length - position));
+  return position;
 }
 
-ICalErrorCode extractBetweenTags(List props, List* extracted, ICalErrorCode onFailError, char* tag) {
-  clearList(extracted); // Clear the list just in case
-  ListIterator propsIterator = createIterator(props);
+// What an event from createLazyCalendarFromBuffer needs to decode its lines
+typedef struct eventLoader {
+  Event* event;
+  const char* lines; // From after BEGIN:VEVENT to before END:VEVENT, in the buffer the calendar adopted
+  size_t length;
+  int decoded; // Set once the lines have been decoded, after which the rest is only read
+  ICalErrorCode error; // What decoding them found
+} EventLoader;
+
+// Held while any lazily parsed event is decoded. Decoding allocates from the calendar's arena, which is not safe to share
+static pthread_mutex_t eventLoaderLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Gives the lines of a lazily parsed event that turned out to be broken back to the calendar, like returnEventLines, and frees the event
+void returnLazyEventLines(Calendar* calendar, Event* event, const char* lines, size_t length, Property* UID, Property* DTSTAMP) {
+  unfoldBufferIntoList(lines, length, &calendar->properties, NULL); // They were checked when they were scanned
+  arenaDelete(calendar->arena, UID, &deletePropertyListFunction);
+  arenaDelete(calendar->arena, DTSTAMP, &deletePropertyListFunction);
+  arenaDelete(calendar->arena, event, &deleteEventListFunction);
+}
 
-  // Build the regex expressions for begin and end tags
-  size_t tagSize = strlen(tag);
-  size_t beginTagSize = (strlen("^BEGIN:$") + tagSize) * sizeof(char);
-  char beginTag[beginTagSize];
-  strcpy(beginTag, "^BEGIN:");
-  strcat(beginTag, tag);
-  strcat(beginTag, "$");
+/**
+  *Closes an event from createLazyCalendarFromBuffer. Leaves it a loader for its lines and sets its UID and DTSTAMP
+  *the way createEvent would. UID is NULL if the event had more than one
+  *@return: the error createEvent would have returned if the UID or DTSTAMP are not usable. The event is only put in
+  * the calendar if they are
+*/
+ICalErrorCode finishLazyEvent(Calendar* calendar, Event* event, const char* lines, size_t length, Property* UID, Property* DTSTAMP) {
+  EventLoader* loader = arenaAlloc(calendar->arena, sizeof(EventLoader));
+  loader->event = event;
+  loader->lines = lines;
+  loader->length = length;
+  loader->decoded = 0;
+  loader->error = OK;
+  event->loader = loader;
+
+  ICalErrorCode error = INV_EVENT;
+  if (UID && DTSTAMP && strlen(UID->propDescr) > 0 && strlen(DTSTAMP->propDescr) > 0) {
+    const char* uid = getPropertyValue(UID);
+    setEventUID(event, getPropertyParameterCount(UID) == 0 && (uid[0] == ':' || uid[0] == ';') ? uid + 1 : uid);
+    error = createTime(event, getPropertyValue(DTSTAMP));
+  }
+  if (error != OK) {
+    error = loadEvent(event); // Something is wrong with it. Decoding it finds the same error createEvent would
+  }
+  if (error != OK) {
+    arenaDelete(calendar->arena, event, &deleteEventListFunction);
+    return error;
+  }
+  insertBack(&calendar->events, event);
+  return OK;
+}
 
-  size_t endTagSize = (strlen("^END:$") + tagSize) * sizeof(char);
-  char endTag[endTagSize];
-  strcpy(endTag, "^END:");
-  strcat(endTag, tag);
-  strcat(endTag, "$");
+// Decodes the lines of a lazily parsed event into its properties and alarms, exactly like createCalendar would have
+void decodeEventLines(EventLoader* loader) {
+  Event* event = loader->event;
+  List eventLines = initializeListInArena(event->properties.arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  ICalErrorCode error = unfoldBufferIntoList(loader->lines, loader->length, &eventLines, NULL);
+  if (error == OK) {
+    error = createEvent(eventLines, event); // Takes the lines over
+  } else {
+    clearList(&eventLines);
+  }
+  loader->error = error;
+}
 
-  Property* prop;
-  // These two ints count as flags to see if we have come across an event open/close
-  int beginCount = 0;
-  int endCount = 0;
-  while ((prop = nextElement(&propsIterator)) != NULL) {
-    char* line = props.printData(prop);
-    if (match(line, beginTag)) {
-      beginCount ++; // Set begin flag
-      if (beginCount != 1) {
-        safelyFreeString(line);
-        return onFailError; // Opened another event without closing the previous
+ICalErrorCode loadEvent(Event* event) {
+  EventLoader* loader = event->loader;
+  if (!loader) {
+    return OK; // Never lazy
+  }
+  if (!__atomic_load_n(&loader->decoded, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&eventLoaderLock);
+    if (!loader->decoded) { // Another thread may have decoded it while this one waited
+      decodeEventLines(loader);
+      __atomic_store_n(&loader->decoded, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&eventLoaderLock);
+  }
+  return loader->error;
+}
+
+/**
+  *Extracts the property from a complete line and inserts it into the list.
+  *A line can still hold more than one line break if the file mixed bare LF endings
+  *with folding, in which case every piece is handled as if it were its own line
+*/
+ICalErrorCode parseUnfoldedLine(const char* line, size_t length, List* list) {
+  size_t start = 0;
+  while (start < length) {
+    const char* piece = line + start;
+    const char* newLine = memchr(piece, '\n', length - start);
+    size_t pieceLength = newLine ? (size_t)(newLine - piece) + 1 : length - start;
+    start += pieceLength;
+
+    if (piece[0] == ';') {
+      continue; // This is a line comment
+    }
+    if (isFoldedLine(piece, pieceLength)) {
+      Property* last = getFromBack(*list);
+      if (!last) {
+        return INV_CAL; // The first line cannot be a line continuation
       }
-    } else if (match(line, endTag)) {
-      endCount ++; // Set end flag
-      if (endCount != beginCount) {
-        safelyFreeString(line);
-        return onFailError; // Closed an event without opening one
+      if (piece[pieceLength - 1] == '\n' && pieceLength >= 2 && piece[pieceLength - 2] == '\r') {
+        pieceLength -= 2; // Remove the line ending
+      }
+      replaceBack(list, appendToProperty(last, piece + 1, pieceLength - 1, list->arena)); // Concat this line onto the property description without the space
+      continue;
+    }
+
+    if (piece[pieceLength - 1] == '\n') { // Remove new line from end of line
+      if (pieceLength >= 2 && piece[pieceLength - 2] == '\r') { // Remove carriage return if it exists
+        pieceLength -= 2;
+      } else {
+        return INV_FILE; // Lines must end in CRLF
       }
-      safelyFreeString(line);
-      break; // We have parsed out the event
-    } else if (beginCount == 1 && endCount == 0) { // If begin is 'open', add this line to the list
-      Property* p = extractPropertyFromLine(line);
-      insertBack(extracted, p);
     }
-    safelyFreeString(line); // Bye
+    if (!isPropertyLine(piece, pieceLength)) {
+      return INV_CAL;
+    }
+    insertBack(list, extractPropertyFromView(piece, pieceLength, list->arena)); // Insert the property into the list
   }
-  if (beginCount == 0 && endCount == 0) { // If we didnt parse any tags at all
-    return onFailError;
+  return OK;
+}
+
+// Returns 1 if the line is the continuation of a folded line (starts with a space or tab and isnt blank)
+int isFoldedLine(const char* line, size_t length) {
+  return length >= 2 && (line[0] == ' ' || line[0] == '\t');
+}
+
+// Returns 1 if the line looks like NAME:description or NAME;description
+int isPropertyLine(const char* line, size_t length) {
+  size_t i = 0;
+  while (i < length && ((line[i] >= 'a' && line[i] <= 'z') || (line[i] >= 'A' && line[i] <= 'Z') || line[i] == '-')) {
+    i ++;
   }
+  return i < length && (line[i] == ':' || line[i] == ';');
+}
 
-  if (beginCount == 1 && endCount != beginCount) { // If there is no matching end tag
-    return onFailError;
+// Appends n chars of c onto the line, growing it if there is not enough room
+void appendToLine(char** line, size_t* length, size_t* capacity, const char* c, size_t n) {
+  if (*length + n + 1 > *capacity) {
+    while (*length + n + 1 > *capacity) {
+      *capacity *= 2; // Double the room so we dont have to grow every time
+    }
+    *line = realloc(*line, *capacity);
   }
+  memcpy(*line + *length, c, n);
+  *length += n;
+  (*line)[*length] = '\0';
+}
 
-  return OK; // If we made it here, we have extracted between the tags
+// Removes the property itself (not one that happens to print the same) from the list and frees it
+void deleteProperty(List* propList, Property* p) {
+  arenaDelete(propList->arena, removeFromList(propList, p), &deletePropertyListFunction);
 }
 
 // Make a string that is pretty (Just like you)
 char* printDatePretty(DateTime dt) {
-  size_t size = 0;
-  size += strlen(dt.date);
-  size += strlen("// ");
-  size += strlen(dt.time);
-  if (dt.UTC) {
-    size += strlen("Z");
+  StringBuilder string = initializeStringBuilder(sizeof(dt.date) + sizeof(dt.time) + 2);
+  appendDate(&string, dt);
+  return finishString(&string);
+}
+
+// Appends a date the way printDatePretty prints it
+void appendDate(StringBuilder* string, DateTime dt) {
+  appendStrings(string, dt.date, "T", dt.time, dt.UTC ? "Z" : "", NULL);
+}
+
+// Appends a property the way printPropertyListFunction prints it
+void appendProperty(StringBuilder* string, const Property* p) {
+  appendStrings(string, p->propName, printedSeparator(p), p->propDescr, NULL);
+}
+
+// Appends a string of an exported component with its length in front of it
+void appendExportField(StringBuilder* string, const char* field) {
+  appendFormat(string, " %zu:", strlen(field));
+  appendString(string, field);
+}
+
+// Appends a P record for each property in the list
+void appendExportProperties(StringBuilder* string, List props) {
+  ListIterator propsIter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&propsIter)) != NULL) {
+    appendFormat(string, "P %zu:", strlen(p->propName) + strlen(printedSeparator(p)) + strlen(p->propDescr));
+    appendProperty(string, p);
+    appendString(string, "\n");
   }
+}
 
-  char* string = malloc(size + 1 * (sizeof(char)));
-  strcpy(string, dt.date);
-  strcat(string, "T");
-  strcat(string, dt.time);
-  if (dt.UTC) {
-    strcat(string, "Z");
+// Appends each property in the list on a line of its own after the indent
+void appendPropertyLines(StringBuilder* string, List props, const char* indent) {
+  ListIterator propsIter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&propsIter)) != NULL) {
+    appendString(string, indent);
+    appendProperty(string, p);
+    appendString(string, "\n");
   }
+}
 
-  return string;
+// Returns the length of the longest line in the string, counting its new line
+size_t longestLineLength(const char* string) {
+  size_t longestLine = 0;
+  while (*string) {
+    const char* end = strchr(string, '\n');
+    size_t lineLength = end ? (size_t) (end - string) + 1 : strlen(string);
+    if (lineLength > longestLine) {
+      longestLine = lineLength; // Congrats, you are the new longest line
+    }
+    string += lineLength;
+  }
+  return longestLine;
 }
 
 int fileExists(char* file) {
@@ -1452,7 +3153,7 @@ int fileExists(char* file) {
 }
 
 // Creates a time and puts it into the sent event
-ICalErrorCode createTime(Event* event, char* timeString) {
+ICalErrorCode createTime(Event* event, const char* timeString) {
   if (!timeString || !event || !matchDATEField(timeString)) { // If its null or doesnt match the required regex
     return INV_CREATEDT;
   }
@@ -1485,22 +3186,68 @@ ICalErrorCode createTime(Event* event, char* timeString) {
   return OK; // You're OK but I have a girlfriend, sorry
 }
 
-// Remove the properties that are in l2 from l1
-void removeIntersectionOfLists(List* l1, List l2) {
-  ListIterator eventIterator = createIterator(l2);
-  char* line;
-  Property* prop;
-  while ((prop = nextElement(&eventIterator)) != NULL) {
-    line = l1->printData(prop);
-    deleteProperty(l1, line); // Delete this line from the iCalendar line list and free the data
-    safelyFreeString(line);
+// Returns 1 if the property is the line BEGIN:component or END:component (tag is PROP_BEGIN or PROP_END), ignoring case
+int isComponentTag(const Property* p, PropertyKind tag, const char* component) {
+  const char* descr = p->propDescr;
+  if (descr[0] == ':') {
+    descr ++; // The description keeps its colon
+  } else if (descr[0] == ';') {
+    return 0; // BEGIN;VEVENT is not a tag
+  }
+  return p->kind == tag && strcasecmp(descr, component) == 0;
+}
+
+// Moves every element of from onto the back of to without copying them. from is left empty
+void moveListElements(List* from, List* to) {
+  ListIterator iter = createIterator(*from);
+  void* data;
+  while ((data = nextElement(&iter)) != NULL) {
+    insertBack(to, data); // To the back, to the back
+  }
+  clearListNodes(from);
+}
+
+// Creates a calendar with no version, prodID, events or properties
+Calendar* newEmptyCalendar() {
+  Calendar* calendar = calloc(sizeof(Calendar), 1);
+  calendar->version = -1;
+  calendar->events = initializeList(&printEventListFunction, &deleteEventListFunction, &compareEventListFunction);
+  calendar->properties = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  return calendar;
+}
+
+// Creates an empty calendar that owns an arena. The calendar and everything that gets parsed into it come from the arena
+Calendar* newArenaCalendar() {
+  Arena* arena = newArena();
+  Calendar* calendar = arenaCalloc(arena, sizeof(Calendar));
+  calendar->version = -1;
+  calendar->events = initializeListInArena(arena, &printEventListFunction, &deleteEventListFunction, &compareEventListFunction);
+  calendar->properties = initializeListInArena(arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  calendar->arena = arena;
+  return calendar;
+}
+
+// Deletes a calendar that owns an arena. Nothing in the arena has to be walked, the arena is let go of in one go
+void deleteArenaCalendar(Calendar* obj) {
+  if (obj->events.arena != obj->arena) {
+    clearList(&obj->events); // Someone swapped the list for one that does not live in the arena
+    unindexEventList(&obj->events);
+  }
+  if (obj->properties.arena != obj->arena) {
+    clearList(&obj->properties);
   }
+  freeArena(obj->arena); // Deletes anything that was added from outside too, then the calendar itself
 }
 
 Event* newEmptyEvent() {
-  Event* e = calloc(sizeof(Event), 1); // MAKE ROOM FOR ME, GOSH!
-  e->properties = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Set the lists
-  e->alarms = initializeList(&printAlarmListFunction, &deleteAlarmListFunction, &compareAlarmListFunction);
+  return newEmptyEventInArena(NULL);
+}
+
+// Creates an empty event whose memory and lists come from the arena (or malloc if it is NULL)
+Event* newEmptyEventInArena(Arena* arena) {
+  Event* e = arenaCalloc(arena, sizeof(Event)); // MAKE ROOM FOR ME, GOSH!
+  e->properties = initializeListInArena(arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Set the lists
+  e->alarms = initializeListInArena(arena, &printAlarmListFunction, &deleteAlarmListFunction, &compareAlarmListFunction);
   return e; // We done
 }
 
@@ -1511,104 +3258,115 @@ List copyPropList(List toBeCopied) {
   Property* p;
 
   while ((p = nextElement(&iter)) != NULL) {
-    char* c = toBeCopied.printData(p); // Print the data
-    Property* p = extractPropertyFromLine(c); // Extract a property from the line
-    insertBack(&newList, p); // ... And the bus driver said, to the back, to the back
-    safelyFreeString(c); // Bye
+    insertBack(&newList, copyProperty(p, NULL)); // ... And the bus driver said, to the back, to the back
   }
   return newList; // Return the new list
 }
 
+/** Sorts the lines of an event (everything between its BEGIN and END tags) into the event's properties and alarms
+  in a single pass. The event takes the lines over and eventList is emptied before returning
+*/
 ICalErrorCode createEvent(List eventList, Event* event) {
   if (!event) {
+    clearList(&eventList);
     return INV_EVENT;
   }
 
-  // Creating a property list that wil store all of the alarm props
-  List alarmPropList = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
-  // Copy a new event list
-  List newEventList = copyPropList(eventList);
-
-  // While we still have VALARM tags
-  while (extractBetweenTags(newEventList, &alarmPropList, INV_EVENT, "VALARM") != INV_EVENT) {
-    Alarm* a = createAlarmFromPropList(alarmPropList);
+  ICalErrorCode alarmError = OK;
+  Arena* arena = eventList.arena; // The event's lines and everything made out of them live here
+  List alarmLines = initializeListInArena(arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Lines of the open alarm
+  Property* alarmBegin = NULL; // The BEGIN:VALARM tag of the open alarm
+  int alarmsBroken = 0; // Set when the alarm tags are out of order. Everything after that stays with the event
 
-    if (a) {
-      insertBack(&event->alarms, a); // Put the alarm in
-      removeIntersectionOfLists(&newEventList, alarmPropList); // Remove all elements from alarmPropList in newEventList
-      deleteProperty(&newEventList, "BEGIN:VALARM"); // Remove Begin and end tags
-      deleteProperty(&newEventList, "END:VALARM");
+  ListIterator linesIterator = createIterator(eventList);
+  Property* prop;
+  while ((prop = nextElement(&linesIterator)) != NULL) {
+    if (alarmError != OK || alarmsBroken) {
+      insertBack(&event->properties, prop); // Nothing left to sort
+    } else if (isComponentTag(prop, PROP_BEGIN, "VALARM")) {
+      if (alarmBegin) { // Opened another alarm without closing the previous
+        insertBack(&event->properties, alarmBegin);
+        moveListElements(&alarmLines, &event->properties);
+        insertBack(&event->properties, prop);
+        alarmBegin = NULL;
+        alarmsBroken = 1;
+      } else {
+        alarmBegin = prop;
+      }
+    } else if (isComponentTag(prop, PROP_END, "VALARM")) {
+      if (alarmBegin) {
+        Alarm* a = createAlarmFromPropList(alarmLines);
+        if (a) {
+          insertBack(&event->alarms, a); // Put the alarm in
+        } else {
+          alarmError = INV_ALARM; // Invalid alarm
+        }
+        clearList(&alarmLines); // The alarm made its own copies
+        arenaDelete(arena, alarmBegin, &deletePropertyListFunction);
+        arenaDelete(arena, prop, &deletePropertyListFunction);
+        alarmBegin = NULL;
+      } else { // Closed an alarm without opening one
+        insertBack(&event->properties, prop);
+        alarmsBroken = 1;
+      }
+    } else if (alarmBegin) {
+      insertBack(&alarmLines, prop);
     } else {
-      clearList(&newEventList); // Clear lists before returning
-      clearList(&alarmPropList);
-      return INV_ALARM; // Invalid event
+      insertBack(&event->properties, prop);
     }
-    clearList(&alarmPropList); // Clear the list
   }
+  clearListNodes(&eventList); // Every line has been moved or freed
 
-  ListIterator eventIterator = createIterator(newEventList); // Iterate over remaining props
-  Property* prop;
+  if (alarmBegin) { // The last alarm was never closed
+    insertBack(&event->properties, alarmBegin);
+    moveListElements(&alarmLines, &event->properties);
+  }
+  if (alarmError != OK) {
+    return alarmError;
+  }
+
+  ListIterator eventIterator = createIterator(event->properties); // Iterate over remaining props
 
-  char* UID = NULL; // Placeholders for uid and dstamp
-  char* DTSTAMP = NULL;
+  Property* UID = NULL; // Placeholders for uid and dstamp
+  Property* DTSTAMP = NULL;
 
   while ((prop = nextElement(&eventIterator)) != NULL) {
-    char* propName = prop->propName; // make these for better readability
+    const char* propName = prop->propName; // make these for better readability
     char* propDescr = prop->propDescr;
     if (strcmp(propDescr, "") == 0 || strcmp(propName, "") == 0) { // If no descripting, we are in trouble
-      safelyFreeString(UID); // Free strings before returning
-      safelyFreeString(DTSTAMP);
-      clearList(&newEventList); // Clear list before returning
       return INV_EVENT;
     }
-    if (match(propName, "^UID$")) { // If this is the UID
+    if (prop->kind == PROP_UID) { // If this is the UID
       if (UID != NULL || !propDescr || !strlen(propDescr)) { // If there is a problem with it
-        safelyFreeString(UID); // Free strings before returning
-        safelyFreeString(DTSTAMP);
-        clearList(&newEventList); // Clear list before returning
         return INV_EVENT; // UID has already been assigned or propDesc is null or empty
       }
-      if (match(propDescr, "^(;|:)")) { // If the description starts with (semi)colon
-        char temp[strlen(propDescr)];
-        memcpy(temp, propDescr + 1*sizeof(char), strlen(propDescr)); // Shift the memory to get rid of the (semi)colon
-        strcpy(event->UID, temp); // Copy it over
+      const char* value = getPropertyValue(prop); // After any parameters
+      if (getPropertyParameterCount(prop) == 0 && match(value, "^(;|:)")) { // If the description starts with (semi)colon
+        setEventUID(event, value + 1); // Copy it over without the (semi)colon
       } else {
-        strcpy(event->UID, propDescr); // Copy it over
+        setEventUID(event, value); // Copy it over
       }
 
-      UID = eventList.printData(prop); // Set the UID
-    } else if (match(propName, "^DTSTAMP$")) {
+      UID = prop; // Set the UID
+    } else if (prop->kind == PROP_DTSTAMP) {
       if (DTSTAMP != NULL || !propDescr) { // If the date is problematic
-        safelyFreeString(UID); // Free before returning
-        safelyFreeString(DTSTAMP);
-        clearList(&newEventList);
         return INV_EVENT; // DTSTAMP has already been assigned or propDesc is null or empty
       }
-      DTSTAMP = eventList.printData(prop); // Set the DTSTAMP flag
-      ICalErrorCode e = createTime(event, propDescr);
+      DTSTAMP = prop; // Set the DTSTAMP flag
+      ICalErrorCode e = createTime(event, getPropertyValue(prop));
       if (e != OK) {
-        safelyFreeString(UID); // Free stored UID
-        safelyFreeString(DTSTAMP); // Free stored DTSTAMP
-        clearList(&newEventList);
         return e;
       }
     }
   }
 
   if (!UID || !DTSTAMP) { // If wecould not find UID or DTSTAMP
-    safelyFreeString(UID); // Free stored UID
-    safelyFreeString(DTSTAMP); // Free stored DTSTAMP
-    clearList(&newEventList);
     return INV_EVENT;
   }
 
-  deleteProperty(&newEventList, UID); // Delete UID from event properties
-  deleteProperty(&newEventList, DTSTAMP); // Delete DTSTAMP from event properties
-  safelyFreeString(UID); // Free stored UID
-  safelyFreeString(DTSTAMP); // Free stored DTSTAMP
-
-  event->properties = newEventList; // Set properties
-  clearList(&alarmPropList);
+  deleteProperty(&event->properties, UID); // Delete UID from event properties
+  deleteProperty(&event->properties, DTSTAMP); // Delete DTSTAMP from event properties
+  indexLongPropertyList(&event->properties);
 
   return OK;
 }
@@ -1616,127 +3374,74 @@ ICalErrorCode createEvent(List eventList, Event* event) {
 ICalErrorCode parseRequirediCalTags(List* list, Calendar* cal) {
   ListIterator iterator = createIterator(*list); // Iterate over props
   Property* p;
-  char* VERSION = NULL;
-  char* PRODID = NULL;
+  Property* version = NULL; // The properties themselves so they can be deleted once we are done
+  Property* prodID = NULL;
+  float number = 0; // The version, which is only set on the calendar once both tags are there
   while ((p = nextElement(&iterator)) != NULL) {
-    char* name = p->propName;
-    char* description = p->propDescr;
-
-    if (match(name, "^VERSION$")) {
-      if (VERSION) {
-        safelyFreeString(PRODID); // PROD might be allocated so we must remove it before returning
-        safelyFreeString(VERSION); // Version might be allocated so we must remove it before returning
+    if (p->kind == PROP_VERSION) {
+      if (version) {
         return DUP_VER;
       }
-      if (!description || !match(description, "^(:|;){0,1}[[:digit:]]+(\\.[[:digit:]]+)*$")) {
-        safelyFreeString(PRODID); // PROD might be allocated so we must remove it before returning
-        safelyFreeString(VERSION); // Version might be allocated so we must remove it before returning
+      if (!parseVersion(p, &number)) {
         return INV_VER;
       }
-
-      VERSION = malloc(strlen(description) * sizeof(char) + 1);
-      if (match(description, "^(;|:)")) {
-        memmove(VERSION, description+1, strlen(description)); // remove the first character as it is (; or :)
-      } else {
-        strcpy(VERSION, description);
-      }
-    } else if (match(name, "^PRODID$")) {
-      if (PRODID) {
-        safelyFreeString(PRODID); // PROD might be allocated so we must remove it before returning
-        safelyFreeString(VERSION); // Version might be allocated so we must remove it before returning
+      version = p;
+    } else if (p->kind == PROP_PRODID) {
+      if (prodID) {
         return DUP_PRODID;
       }
-
-      if (!description || !matchTEXTField(description)) {
-        safelyFreeString(PRODID); // PROD might be allocated so we must remove it before returning
-        safelyFreeString(VERSION); // Version might be allocated so we must remove it before returning
+      if (!parseProdID(p)) {
         return INV_PRODID;
       }
-      PRODID = malloc(strlen(description) * sizeof(char) + 1);
-        if (match(description, "^(;|:)")) {
-          memmove(PRODID, description+1, strlen(description)); // remove the first character as it is (; or :)
-        } else {
-          strcpy(PRODID, description);
-        }
+      prodID = p;
     }
   }
 
-  if (!VERSION || !PRODID) {
-    safelyFreeString(PRODID); // PROD might be allocated so we must remove it before returning
-    safelyFreeString(VERSION); // Version might be allocated so we must remove it before returning
-
+  if (!version || !prodID) {
     return INV_CAL; // We are missing required tags
   }
 
-  Property* prodID = findElement(*list, &compareTags, "PRODID"); // Find the tags for prodID and version for eleting
-  Property* version = findElement(*list, &compareTags, "VERSION");
-
-  char* prodIDLine = printPropertyListFunction(prodID); // print their lines
-  char* versionLine = printPropertyListFunction(version);
+  cal->version = number;
+  setCalendarProdID(cal, parseProdID(prodID));
 
-  deleteProperty(list, versionLine); // Delete them
-  deleteProperty(list, prodIDLine);
-
-  safelyFreeString(prodIDLine); // Free memory
-  safelyFreeString(versionLine);
-
-  cal->version = atof(VERSION);
-  strcpy(cal->prodID, PRODID);
-  safelyFreeString(PRODID); // Free strings before returning
-  safelyFreeString(VERSION);
+  deleteProperty(list, version); // They live in the calendar struct now
+  deleteProperty(list, prodID);
   return OK;
 }
 
-void updateLongestLineAndIncrementStringSize(size_t* longestLine, size_t* lineLength, size_t* stringSize) {
-  if (*lineLength > *longestLine) { // If this line is greater than the previous longest line
-    *longestLine = *lineLength; // Congrats, you are the new longest line
+// Reads the number out of a VERSION property. Returns 0 if it is not a version number
+int parseVersion(const Property* p, float* version) {
+  const char* VERSION = getPropertyValue(p);
+  if (!match(VERSION, "^(:|;){0,1}[[:digit:]]+(\\.[[:digit:]]+)*$")) {
+    return 0;
   }
-  *stringSize += *lineLength; // Add this line length to the string size
-  *lineLength = 0; // Reset the line length
-}
-
-void calculateLineLength(size_t* lineLength, const char* c, ... ) {
-   va_list valist;
-   va_start(valist, c);
-
-   // Iterate over all variable params
-   while (c) {
-        *lineLength += strlen(c); // Add the length of this string to the total
-        c = va_arg(valist, const char*); // Move to the next
-    }
-   // Clear the va_list
-   va_end(valist);
-}
-
-void concatenateLine(char* string, const char* c, ... ) {
-   va_list valist;
-   va_start(valist, c);
-
-    // Iterate over all variable params
-   while (c) {
-        strcat(string, c); // concatenate each value onto the string
-        c = va_arg(valist, const char*); // Move to the next
-    }
-   // Clear the va_list
-   va_end(valist);
+  if (getPropertyParameterCount(p) == 0 && (VERSION[0] == ':' || VERSION[0] == ';')) {
+    VERSION ++; // Skip the (semi)colon
+  }
+  *version = atof(VERSION);
+  return 1;
 }
 
-bool compareTags(const void* first, const void* second) {
-  Property* p = (Property*) first;
-  char* propName = p->propName;
-  if (strcmp(propName, (char*) second) == 0) {
-    return true;
+// Returns where the ID starts in a PRODID property, or NULL if it is not valid TEXT
+const char* parseProdID(const Property* p) {
+  const char* PRODID = getPropertyValue(p);
+  if (!matchTEXTField(PRODID)) {
+    return NULL;
+  }
+  if (getPropertyParameterCount(p) == 0 && (PRODID[0] == ':' || PRODID[0] == ';')) {
+    PRODID ++;
   }
-  return false;
+  return PRODID;
 }
 
-int getSpaces(char* line) {
-  int count = 0;
-  char c;
-  while ((c = line[count]) == ' ') {
-    count ++;
+bool compareTags(const void* first, const void* second) {
+  const Property* p = (const Property*) first;
+  const char* name = (const char*) second;
+  PropertyKind kind = getPropertyKind(name, strlen(name));
+  if (kind != PROP_OTHER) {
+    return p->kind == kind; // Known names compare as kinds
   }
-  return count;
+  return strcmp(p->propName, name) == 0;
 }
 
 // If you made it this far, you win. Too bad the prize is nothing
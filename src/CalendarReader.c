@@ -0,0 +1,256 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file reads calendars a component at a time through a fixed size buffer
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "CalendarReader.h"
+#include "HelperFunctions.h"
+
+// How far past a line scanLogicalLine can look to see if it goes on: a blank line (CRLF) and the fold character and
+// octet after it
+#define CALENDAR_READER_LOOKAHEAD 4
+
+// Source for a FILE*. Goes through the stream so anything it has buffered already is not lost
+ssize_t readFromFile(void* context, char* data, size_t length) {
+  FILE* file = context;
+  size_t got = fread(data, 1, length, file);
+  return got == 0 && ferror(file) ? -1 : (ssize_t) got;
+}
+
+// Source for a file descriptor
+ssize_t readFromFd(void* context, char* data, size_t length) {
+  ssize_t got;
+  while ((got = read(*(int*) context, data, length)) < 0 && errno == EINTR) {
+    // Interrupted before anything was read, so try again
+  }
+  return got;
+}
+
+void initializeCalendarReader(CalendarReader* reader, CalendarSource source, void* context) {
+  reader->source = source;
+  reader->context = context;
+  reader->fd = -1;
+  reader->start = 0;
+  reader->end = 0;
+  reader->finished = 0;
+  reader->failed = 0;
+}
+
+void initializeFileReader(CalendarReader* reader, FILE* file) {
+  initializeCalendarReader(reader, &readFromFile, file);
+}
+
+void initializeFdReader(CalendarReader* reader, int fd) {
+  initializeCalendarReader(reader, &readFromFd, &reader->fd);
+  reader->fd = fd;
+}
+
+// Moves what has not been handled to the front of the buffer and reads more after it
+static void fillReader(CalendarReader* reader) {
+  memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+  reader->end -= reader->start;
+  reader->start = 0;
+  while (!reader->finished && reader->end < CALENDAR_READER_BUFFER_SIZE) {
+    ssize_t got = reader->source(reader->context, reader->buffer + reader->end, CALENDAR_READER_BUFFER_SIZE - reader->end);
+    if (got <= 0) {
+      reader->failed = got < 0;
+      reader->finished = 1;
+    } else {
+      reader->end += got;
+      return;
+    }
+  }
+}
+
+// Where a reader is in the calendar
+typedef struct readerState {
+  const CalendarHandler* handler;
+  int calendarState; // 0 before BEGIN:VCALENDAR, 1 inside the calendar and 2 after END:VCALENDAR
+  Event* event; // The event that is currently open
+  List eventLines; // Lines of the open event
+  int eventCount;
+  int counts[PROP_KIND_COUNT]; // How many of each kind of property the calendar has had
+  float version;
+} ReaderState;
+
+// Builds the open event out of its lines, checks it and hands it to the handler. The event is freed afterwards
+static ICalErrorCode finishEvent(ReaderState* state) {
+  const CalendarHandler* handler = state->handler;
+  Event* event = state->event;
+  state->event = NULL;
+  ICalErrorCode error = createEvent(state->eventLines, event); // Takes the lines over
+  state->eventLines = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  if (error == OK) {
+    error = validateEvent(NULL, event);
+  }
+  state->eventCount ++;
+
+  if (error == OK && handler->eventStart && handler->eventStart(handler->context, event) != 0) {
+    error = OTHER_ERROR;
+  }
+  ListIterator propsIter = createIterator(event->properties);
+  Property* p;
+  while (error == OK && handler->eventProperty && (p = nextElement(&propsIter)) != NULL) {
+    if (handler->eventProperty(handler->context, event, p) != 0) {
+      error = OTHER_ERROR;
+    }
+  }
+  ListIterator alarmIter = createIterator(event->alarms);
+  Alarm* a;
+  while (error == OK && handler->alarm && (a = nextElement(&alarmIter)) != NULL) {
+    if (handler->alarm(handler->context, event, a) != 0) {
+      error = OTHER_ERROR;
+    }
+  }
+  if (error == OK && handler->eventEnd && handler->eventEnd(handler->context, event) != 0) {
+    error = OTHER_ERROR;
+  }
+  deleteEventListFunction(event);
+  return error;
+}
+
+// Checks a property of the calendar itself as soon as it is read, the way parseRequirediCalTags and validateCalProps do
+static ICalErrorCode readCalendarProperty(ReaderState* state, const Property* p) {
+  int count = ++ state->counts[p->kind];
+  if (p->kind == PROP_VERSION) {
+    if (count > 1) {
+      return DUP_VER;
+    }
+    if (!parseVersion(p, &state->version)) {
+      return INV_VER;
+    }
+  } else if (p->kind == PROP_PRODID) {
+    if (count > 1) {
+      return DUP_PRODID;
+    }
+    if (!parseProdID(p)) {
+      return INV_PRODID;
+    }
+  } else if ((p->kind != PROP_CALSCALE && p->kind != PROP_METHOD) || !matchTEXTField(getPropertyValue(p)) || count > 1) {
+    return INV_CAL;
+  }
+
+  const CalendarHandler* handler = state->handler;
+  return handler->calendarProperty && handler->calendarProperty(handler->context, p) != 0 ? OTHER_ERROR : OK;
+}
+
+// Checks what has to be in a calendar once all of it has been read
+static ICalErrorCode finishCalendar(ReaderState* state) {
+  if (state->event || state->eventCount == 0) {
+    return INV_CAL; // The last event was never closed, or there were none
+  }
+  if (state->counts[PROP_VERSION] == 0 || state->counts[PROP_PRODID] == 0) {
+    return INV_CAL; // We are missing required tags
+  }
+  if (!state->version) {
+    return INV_VER; // Must have a version
+  }
+  return OK;
+}
+
+// Puts one property where it belongs, like createCalendarFromLines does, and frees it unless an event keeps it
+static ICalErrorCode readProperty(ReaderState* state, Property* p) {
+  ICalErrorCode error = OK;
+  if (state->calendarState == 2) {
+    // Anything after the calendar is ignored
+  } else if (isComponentTag(p, PROP_BEGIN, "VCALENDAR")) {
+    error = state->calendarState == 1 ? INV_CAL : OK; // Opened another calendar without closing this one
+    state->calendarState = 1;
+  } else if (isComponentTag(p, PROP_END, "VCALENDAR")) {
+    error = state->calendarState == 0 ? INV_CAL : finishCalendar(state); // Closed a calendar without opening one
+    state->calendarState = 2;
+  } else if (state->calendarState == 0) {
+    // Anything before the calendar is ignored
+  } else if (isComponentTag(p, PROP_BEGIN, "VEVENT")) {
+    if (state->event) {
+      error = INV_CAL; // Opened another event without closing the previous
+    } else {
+      state->event = newEmptyEvent();
+    }
+  } else if (isComponentTag(p, PROP_END, "VEVENT")) {
+    error = state->event ? finishEvent(state) : INV_CAL; // Closed an event without opening one
+  } else if (state->event) {
+    insertBack(&state->eventLines, p); // Park the line in the event until it is closed
+    return OK;
+  } else {
+    error = readCalendarProperty(state, p);
+  }
+  deletePropertyListFunction(p);
+  return error;
+}
+
+ICalErrorCode readCalendar(CalendarReader* reader, const CalendarHandler* handler) {
+  ReaderState state = {.handler = handler};
+  state.eventLines = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+  List lines = initializeList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction); // Properties of the line being read
+  ICalErrorCode error = OK;
+
+  while (error == OK) {
+    size_t available = reader->end - reader->start;
+    size_t length = available > 0 ? scanLogicalLine(reader->buffer + reader->start, available) : 0;
+    if (!reader->finished && length + CALENDAR_READER_LOOKAHEAD > available) { // Whatever comes next might still be a continuation of the line
+      if (reader->start == 0 && reader->end == CALENDAR_READER_BUFFER_SIZE) {
+        error = INV_FILE; // The line does not fit
+      } else {
+        fillReader(reader);
+      }
+      continue;
+    }
+    if (reader->failed) {
+      error = INV_FILE;
+    } else if (length == 0) {
+      break; // The end
+    } else {
+      error = unfoldBufferIntoList(reader->buffer + reader->start, length, &lines, NULL); // Checked exactly like a whole file would be
+      reader->start += length;
+    }
+
+    ListIterator linesIter = createIterator(lines);
+    Property* p;
+    while ((p = nextElement(&linesIter)) != NULL) {
+      if (error == OK) {
+        error = readProperty(&state, p);
+      } else {
+        deletePropertyListFunction(p);
+      }
+    }
+    clearListNodes(&lines); // Every property has been moved or freed
+  }
+
+  if (error == OK && state.calendarState != 2) {
+    error = INV_CAL; // The calendar was missing or unclosed
+  }
+  if (state.event) {
+    clearList(&state.eventLines);
+    deleteEventListFunction(state.event);
+  }
+  return error;
+}
+
+ICalErrorCode readCalendarFile(char* fileName, const CalendarHandler* handler) {
+  int fd;
+  // If the fileName is NULL or does not match the regex expression *.ics or cannot be opened
+  if (!fileName || !match(fileName, ".+\\.ics$") || (fd = open(fileName, O_RDONLY)) == -1) {
+    return INV_FILE; // The file is invalid
+  }
+  CalendarReader* reader = malloc(sizeof(CalendarReader)); // Too big to want on the stack
+  if (!reader) {
+    close(fd);
+    return OTHER_ERROR;
+  }
+  initializeFdReader(reader, fd);
+  ICalErrorCode error = readCalendar(reader, handler);
+  free(reader);
+  close(fd);
+  return error;
+}
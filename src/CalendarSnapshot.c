@@ -0,0 +1,346 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file saves parsed calendars as binary snapshots and loads them back without parsing
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "CalendarParser.h"
+#include "HelperFunctions.h"
+
+#define SNAPSHOT_MAGIC "ICALSNAP"
+#define SNAPSHOT_FORMAT 2 // Bumped whenever the layout below changes, so old snapshots are rejected instead of misread
+#define SNAPSHOT_BYTE_ORDER 0x01020304 // Reads back differently on a machine with the other byte order
+
+/**
+ * Start of a snapshot. It is followed by the event, alarm and property tables and then the string table.
+ * Strings are stored as offsets into the string table, where each one is null terminated
+ **/
+typedef struct snapshotHeader {
+  char magic[8];
+  uint32_t format;
+  uint32_t byteOrder;
+  float version;
+  uint32_t prodID;
+  uint32_t firstProperty; // The calendar's own properties
+  uint32_t propertyCount;
+  uint32_t events; // Number of rows in each table
+  uint32_t alarms;
+  uint32_t properties;
+  uint32_t stringBytes;
+} SnapshotHeader;
+
+typedef struct snapshotEvent {
+  uint32_t UID;
+  uint32_t firstProperty;
+  uint32_t propertyCount;
+  uint32_t firstAlarm;
+  uint32_t alarmCount;
+  char date[9];
+  char time[7];
+  uint8_t UTC;
+} SnapshotEvent;
+
+typedef struct snapshotAlarm {
+  uint32_t action;
+  uint32_t trigger;
+  uint32_t firstProperty;
+  uint32_t propertyCount;
+} SnapshotAlarm;
+
+typedef struct snapshotProperty {
+  uint32_t name; // Names are only stored once however many properties share them
+  uint32_t descr;
+  uint32_t descrLength;
+  uint32_t parameters; // 1 if the description starts with parameters, which are picked out again when it is loaded
+} SnapshotProperty;
+
+/**
+ * Everything a snapshot is built out of while the calendar is walked. Property names are interned, so the
+ * offset of each name is remembered by its pointer
+ **/
+typedef struct snapshotBuilder {
+  StringBuilder events;
+  StringBuilder alarms;
+  StringBuilder properties;
+  StringBuilder strings;
+  uint32_t eventCount;
+  uint32_t alarmCount;
+  uint32_t propertyCount;
+  const char** names;
+  uint32_t* nameOffsets;
+  size_t nameCapacity; // Always a power of 2
+  size_t nameCount;
+} SnapshotBuilder;
+
+// Adds a string to the string table and returns its offset
+static uint32_t addSnapshotString(SnapshotBuilder* builder, const char* string, size_t length) {
+  uint32_t offset = builder->strings.length;
+  appendChars(&builder->strings, string, length);
+  appendChars(&builder->strings, "", 1); // Keep the null terminator
+  return offset;
+}
+
+// Returns the offset of an interned property name, adding it to the string table the first time it is seen
+static uint32_t addSnapshotName(SnapshotBuilder* builder, const char* name) {
+  if (builder->nameCount * 2 >= builder->nameCapacity) { // Grow before the table gets crowded
+    size_t capacity = builder->nameCapacity ? builder->nameCapacity * 2 : 64;
+    const char** names = calloc(capacity, sizeof(char*));
+    uint32_t* offsets = malloc(capacity * sizeof(uint32_t));
+    if (!names || !offsets) {
+      free(names);
+      free(offsets);
+      builder->strings.failed = 1; // Fails the whole snapshot
+      return 0;
+    }
+    for (size_t i = 0; i < builder->nameCapacity; i ++) {
+      if (builder->names[i]) {
+        size_t slot = ((uintptr_t) builder->names[i] >> 3) & (capacity - 1);
+        while (names[slot]) {
+          slot = (slot + 1) & (capacity - 1);
+        }
+        names[slot] = builder->names[i];
+        offsets[slot] = builder->nameOffsets[i];
+      }
+    }
+    free(builder->names);
+    free(builder->nameOffsets);
+    builder->names = names;
+    builder->nameOffsets = offsets;
+    builder->nameCapacity = capacity;
+  }
+
+  size_t slot = ((uintptr_t) name >> 3) & (builder->nameCapacity - 1);
+  while (builder->names[slot] && builder->names[slot] != name) {
+    slot = (slot + 1) & (builder->nameCapacity - 1);
+  }
+  if (!builder->names[slot]) {
+    builder->names[slot] = name;
+    builder->nameOffsets[slot] = addSnapshotString(builder, name, strlen(name));
+    builder->nameCount ++;
+  }
+  return builder->nameOffsets[slot];
+}
+
+// Adds a row to the property table for each property in the list. Returns the first row
+static uint32_t addSnapshotProperties(SnapshotBuilder* builder, List props) {
+  uint32_t first = builder->propertyCount;
+  ListIterator propsIter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&propsIter)) != NULL) {
+    SnapshotProperty row;
+    row.name = addSnapshotName(builder, p->propName);
+    row.descrLength = strlen(p->propDescr);
+    row.descr = addSnapshotString(builder, p->propDescr, row.descrLength);
+    row.parameters = p->paramsOffset != 0; // The name was followed by ';'
+    appendChars(&builder->properties, (const char*) &row, sizeof(row));
+    builder->propertyCount ++;
+  }
+  return first;
+}
+
+ICalErrorCode writeCalendarSnapshot(char* fileName, const Calendar* obj) {
+  ICalErrorCode error = validateCalendar(obj); // Loading skips validation, so only valid calendars are saved
+  if (error != OK) {
+    return error;
+  }
+
+  SnapshotBuilder builder = {
+    .events = initializeStringBuilder(0), .alarms = initializeStringBuilder(0),
+    .properties = initializeStringBuilder(0), .strings = initializeStringBuilder(0)
+  };
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.format = SNAPSHOT_FORMAT;
+  header.byteOrder = SNAPSHOT_BYTE_ORDER;
+  header.version = obj->version;
+  header.prodID = addSnapshotString(&builder, getCalendarProdID(obj), strlen(getCalendarProdID(obj)));
+  header.firstProperty = addSnapshotProperties(&builder, obj->properties);
+  header.propertyCount = getLength(obj->properties);
+
+  ListIterator eventIter = createIterator(obj->events);
+  Event* event;
+  while ((event = nextElement(&eventIter))) {
+    loadEvent(event); // Decodes an event from createCalendarLazy
+    SnapshotEvent row;
+    memset(&row, 0, sizeof(row)); // No uninitialized padding in the file
+    row.UID = addSnapshotString(&builder, getEventUID(event), strlen(getEventUID(event)));
+    row.firstProperty = addSnapshotProperties(&builder, event->properties);
+    row.propertyCount = getLength(event->properties);
+    row.firstAlarm = builder.alarmCount;
+    row.alarmCount = getLength(event->alarms);
+    memcpy(row.date, event->creationDateTime.date, sizeof(row.date));
+    memcpy(row.time, event->creationDateTime.time, sizeof(row.time));
+    row.UTC = event->creationDateTime.UTC;
+    appendChars(&builder.events, (const char*) &row, sizeof(row));
+    builder.eventCount ++;
+
+    ListIterator alarmIter = createIterator(event->alarms);
+    Alarm* a;
+    while ((a = nextElement(&alarmIter))) {
+      SnapshotAlarm alarmRow;
+      alarmRow.action = addSnapshotString(&builder, getAlarmAction(a), strlen(getAlarmAction(a)));
+      alarmRow.trigger = addSnapshotString(&builder, a->trigger, strlen(a->trigger));
+      alarmRow.firstProperty = addSnapshotProperties(&builder, a->properties);
+      alarmRow.propertyCount = getLength(a->properties);
+      appendChars(&builder.alarms, (const char*) &alarmRow, sizeof(alarmRow));
+      builder.alarmCount ++;
+    }
+  }
+  header.events = builder.eventCount;
+  header.alarms = builder.alarmCount;
+  header.properties = builder.propertyCount;
+  header.stringBytes = builder.strings.length;
+
+  StringBuilder* tables[] = {&builder.events, &builder.alarms, &builder.properties, &builder.strings};
+  for (int i = 0; i < 4; i ++) {
+    if (tables[i]->failed || tables[i]->length > UINT32_MAX) {
+      error = OTHER_ERROR; // Out of memory, or too big for the offsets
+    }
+  }
+
+  char* tempName = NULL;
+  int fd = error == OK ? openTempFile(fileName, &tempName) : -1;
+  if (error == OK && fd < 0) {
+    error = WRITE_ERROR;
+  }
+  if (error == OK && writeToFd(&fd, (const char*) &header, sizeof(header)) != 0) {
+    error = WRITE_ERROR;
+  }
+  for (int i = 0; i < 4 && error == OK; i ++) {
+    if (tables[i]->length > 0 && writeToFd(&fd, tables[i]->string, tables[i]->length) != 0) {
+      error = WRITE_ERROR;
+    }
+  }
+  if (fd >= 0) {
+    if (error == OK && fsync(fd) != 0) {
+      error = WRITE_ERROR;
+    }
+    if (close(fd) != 0 && error == OK) {
+      error = WRITE_ERROR;
+    }
+    if (error == OK && rename(tempName, fileName) != 0) {
+      error = WRITE_ERROR;
+    }
+    if (error == OK) {
+      syncDirectory(fileName);
+    } else {
+      unlink(tempName); // Never leave half a snapshot behind
+    }
+  }
+  free(tempName);
+  for (int i = 0; i < 4; i ++) {
+    freeStringBuilder(tables[i]);
+  }
+  free(builder.names);
+  free(builder.nameOffsets);
+  return error;
+}
+
+// Returns 1 if rows first up to first + count are all in a table with rows rows
+static int inTable(uint32_t first, uint32_t count, uint32_t rows) {
+  return (uint64_t) first + count <= rows;
+}
+
+// Adds the properties from the property table to the list
+static void loadSnapshotProperties(List* list, const SnapshotProperty* properties, uint32_t first, uint32_t count, const char* strings) {
+  for (uint32_t i = first; i < first + count; i ++) {
+    const char* name = strings + properties[i].name;
+    insertBack(list, createPropertyFromView(name, strlen(name), strings + properties[i].descr, properties[i].descrLength, properties[i].parameters != 0, list->arena));
+  }
+  indexLongPropertyList(list);
+}
+
+ICalErrorCode createCalendarFromSnapshot(char* fileName, Calendar** obj) {
+  *obj = NULL;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0) {
+    return INV_FILE;
+  }
+  struct stat fileInfo;
+  char* data = NULL;
+  size_t size = 0;
+  if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size >= (off_t) sizeof(SnapshotHeader)) {
+    size = fileInfo.st_size;
+    data = malloc(size);
+  }
+  size_t done = 0;
+  while (data && done < size) { // One read unless the kernel hands it over in pieces
+    ssize_t got = readFromFd(&fd, data + done, size - done);
+    if (got <= 0) {
+      break;
+    }
+    done += got;
+  }
+  close(fd);
+  if (!data || done < size) {
+    free(data);
+    return INV_FILE;
+  }
+
+  // Only the layout is checked. The calendar was validated when it was saved
+  SnapshotHeader header;
+  memcpy(&header, data, sizeof(header));
+  uint64_t expectedSize = sizeof(header) + (uint64_t) header.events * sizeof(SnapshotEvent) + (uint64_t) header.alarms * sizeof(SnapshotAlarm)
+    + (uint64_t) header.properties * sizeof(SnapshotProperty) + header.stringBytes;
+  const SnapshotEvent* events = (const SnapshotEvent*) (data + sizeof(header));
+  const SnapshotAlarm* alarms = (const SnapshotAlarm*) (events + header.events);
+  const SnapshotProperty* properties = (const SnapshotProperty*) (alarms + header.alarms);
+  const char* strings = (const char*) (properties + header.properties);
+  int valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 && header.format == SNAPSHOT_FORMAT
+    && header.byteOrder == SNAPSHOT_BYTE_ORDER && expectedSize == size && header.stringBytes > 0 && strings[header.stringBytes - 1] == '\0'
+    && header.prodID < header.stringBytes && inTable(header.firstProperty, header.propertyCount, header.properties);
+  for (uint32_t i = 0; valid && i < header.events; i ++) {
+    valid = events[i].UID < header.stringBytes && inTable(events[i].firstProperty, events[i].propertyCount, header.properties)
+      && inTable(events[i].firstAlarm, events[i].alarmCount, header.alarms) && memchr(events[i].date, '\0', sizeof(events[i].date))
+      && memchr(events[i].time, '\0', sizeof(events[i].time));
+  }
+  for (uint32_t i = 0; valid && i < header.alarms; i ++) {
+    valid = alarms[i].action < header.stringBytes && alarms[i].trigger < header.stringBytes
+      && inTable(alarms[i].firstProperty, alarms[i].propertyCount, header.properties);
+  }
+  for (uint32_t i = 0; valid && i < header.properties; i ++) {
+    valid = properties[i].name < header.stringBytes && (uint64_t) properties[i].descr + properties[i].descrLength < header.stringBytes;
+  }
+  if (!valid) {
+    free(data);
+    return INV_FILE;
+  }
+
+  Calendar* calendar = newArenaCalendar();
+  calendar->version = header.version;
+  setCalendarProdID(calendar, strings + header.prodID);
+  loadSnapshotProperties(&calendar->properties, properties, header.firstProperty, header.propertyCount, strings);
+  for (uint32_t i = 0; i < header.events; i ++) {
+    Event* event = newEmptyEventInArena(calendar->arena);
+    setEventUID(event, strings + events[i].UID);
+    memcpy(event->creationDateTime.date, events[i].date, sizeof(events[i].date));
+    memcpy(event->creationDateTime.time, events[i].time, sizeof(events[i].time));
+    event->creationDateTime.UTC = events[i].UTC;
+    loadSnapshotProperties(&event->properties, properties, events[i].firstProperty, events[i].propertyCount, strings);
+
+    for (uint32_t j = events[i].firstAlarm; j < events[i].firstAlarm + events[i].alarmCount; j ++) {
+      List alarmProps = initializeListInArena(calendar->arena, &printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+      loadSnapshotProperties(&alarmProps, properties, alarms[j].firstProperty, alarms[j].propertyCount, strings);
+      Alarm* a = arenaCalloc(calendar->arena, sizeof(Alarm)); // Not createAlarm, which would strip a leading : or ; again
+      a->properties = alarmProps;
+      setAlarmAction(a, strings + alarms[j].action);
+      a->trigger = replaceField(calendar->arena, NULL, strings + alarms[j].trigger);
+      insertBack(&event->alarms, a);
+    }
+    insertBack(&calendar->events, event);
+  }
+  free(data);
+  *obj = calendar;
+  return OK;
+}
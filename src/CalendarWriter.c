@@ -0,0 +1,208 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file writes calendars out as iCalendar text
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "CalendarWriter.h"
+#include "HelperFunctions.h"
+
+// Sink for a FILE*
+static int writeToFile(void* context, const char* data, size_t length) {
+  return fwrite(data, 1, length, (FILE*) context) == length ? 0 : -1;
+}
+
+// Sink for a file descriptor. Keeps writing until all of it is out
+int writeToFd(void* context, const char* data, size_t length) {
+  int fd = *(int*) context;
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue; // Interrupted before anything was written, so try again
+      }
+      return -1;
+    }
+    data += written;
+    length -= written;
+  }
+  return 0;
+}
+
+void initializeCalendarWriter(CalendarWriter* writer, CalendarSink sink, void* context) {
+  writer->sink = sink;
+  writer->context = context;
+  writer->fd = -1;
+  writer->buffered = 0;
+  writer->column = 0;
+  writer->pending = 0;
+  writer->failed = 0;
+}
+
+void initializeFileWriter(CalendarWriter* writer, FILE* file) {
+  initializeCalendarWriter(writer, &writeToFile, file);
+}
+
+void initializeFdWriter(CalendarWriter* writer, int fd) {
+  initializeCalendarWriter(writer, &writeToFd, &writer->fd);
+  writer->fd = fd;
+}
+
+// Hands the buffer to the sink and empties it
+static void flushWriter(CalendarWriter* writer) {
+  if (writer->buffered > 0 && !writer->failed && writer->sink(writer->context, writer->buffer, writer->buffered) != 0) {
+    writer->failed = 1;
+  }
+  writer->buffered = 0;
+}
+
+// Copies n octets into the buffer, flushing it whenever it fills up
+static void bufferOctets(CalendarWriter* writer, const char* c, size_t n) {
+  while (n > 0) {
+    if (writer->buffered == CALENDAR_WRITER_BUFFER_SIZE) {
+      flushWriter(writer);
+    }
+    size_t room = CALENDAR_WRITER_BUFFER_SIZE - writer->buffered;
+    size_t chunk = n < room ? n : room;
+    memcpy(writer->buffer + writer->buffered, c, chunk);
+    writer->buffered += chunk;
+    c += chunk;
+    n -= chunk;
+  }
+}
+
+// Returns how many octets the UTF-8 character starting with this octet takes. Anything that cannot start one is a character of its own
+static int utf8Length(unsigned char c) {
+  if ((c & 0xF8) == 0xF0) {
+    return 4;
+  }
+  if ((c & 0xF0) == 0xE0) {
+    return 3;
+  }
+  if ((c & 0xE0) == 0xC0) {
+    return 2;
+  }
+  return 1;
+}
+
+// Writes part of a content line, folding it before any character that would not fit on the current line
+static void writeFolded(CalendarWriter* writer, const char* c, size_t n) {
+  size_t start = 0; // Where the octets that have not been buffered yet start
+  for (size_t i = 0; i < n; i ++) {
+    unsigned char octet = c[i];
+    if (writer->pending > 0 && (octet & 0xC0) == 0x80) {
+      writer->pending --; // Rest of a character that has already been placed
+      writer->column ++;
+      continue;
+    }
+    int length = utf8Length(octet);
+    if (writer->column + length > CALENDAR_LINE_OCTETS) {
+      bufferOctets(writer, c + start, i - start);
+      bufferOctets(writer, "\r\n ", 3); // The space is removed again when the line is unfolded
+      writer->column = 1;
+      start = i;
+    }
+    writer->pending = length - 1;
+    writer->column ++;
+  }
+  bufferOctets(writer, c + start, n - start);
+}
+
+// Ends the content line being written
+static void endLine(CalendarWriter* writer) {
+  bufferOctets(writer, "\r\n", 2);
+  writer->column = 0;
+  writer->pending = 0;
+}
+
+void writeCalendarLine(CalendarWriter* writer, const char* name, const char* separator, const char* value) {
+  writeFolded(writer, name, strlen(name));
+  writeFolded(writer, separator, strlen(separator));
+  writeFolded(writer, value, strlen(value));
+  endLine(writer);
+}
+
+void writeCalendarProperty(CalendarWriter* writer, const Property* p) {
+  writeCalendarLine(writer, p->propName, printedSeparator(p), p->propDescr);
+}
+
+void writeCalendarProperties(CalendarWriter* writer, List props) {
+  ListIterator propsIter = createIterator(props);
+  Property* p;
+  while ((p = nextElement(&propsIter)) != NULL) {
+    writeCalendarProperty(writer, p);
+  }
+}
+
+void beginCalendar(CalendarWriter* writer, const char* prodID, float version) {
+  char versionString[64];
+  snprintf(versionString, sizeof(versionString), "%f", version);
+  writeCalendarLine(writer, "BEGIN", ":", "VCALENDAR");
+  writeCalendarLine(writer, "PRODID", ":", prodID);
+  writeCalendarLine(writer, "VERSION", ":", versionString);
+}
+
+ICalErrorCode writeCalendarEvent(CalendarWriter* writer, const Event* event) {
+  loadEvent((Event*) event); // Decodes an event from createCalendarLazy
+  ListIterator alarmIterator = createIterator(event->alarms);
+  Alarm* a;
+  while ((a = nextElement(&alarmIterator)) != NULL) {
+    if (strlen(getAlarmAction(a)) == 0 || strlen(a->trigger) == 0) {
+      return OTHER_ERROR; // Validation lets these through but they cannot be written. Checked first so no half of the event is written
+    }
+  }
+
+  DateTime dt = event->creationDateTime;
+  char creationDateTime[sizeof(dt.date) + sizeof(dt.time) + 2];
+  snprintf(creationDateTime, sizeof(creationDateTime), "%sT%s%s", dt.date, dt.time, dt.UTC ? "Z" : "");
+  writeCalendarLine(writer, "BEGIN", ":", "VEVENT");
+  writeCalendarLine(writer, "UID", ":", getEventUID(event));
+  writeCalendarLine(writer, "DTSTAMP", ":", creationDateTime);
+
+  alarmIterator = createIterator(event->alarms);
+  while ((a = nextElement(&alarmIterator)) != NULL) {
+    writeCalendarLine(writer, "BEGIN", ":", "VALARM");
+    writeCalendarLine(writer, "ACTION", ":", getAlarmAction(a));
+    writeCalendarLine(writer, "TRIGGER", ":", a->trigger);
+    writeCalendarProperties(writer, a->properties);
+    writeCalendarLine(writer, "END", ":", "VALARM");
+  }
+
+  writeCalendarProperties(writer, event->properties);
+  writeCalendarLine(writer, "END", ":", "VEVENT");
+  return OK;
+}
+
+void endCalendar(CalendarWriter* writer) {
+  writeCalendarLine(writer, "END", ":", "VCALENDAR");
+}
+
+ICalErrorCode writeWholeCalendar(CalendarWriter* writer, const Calendar* obj) {
+  beginCalendar(writer, getCalendarProdID(obj), obj->version);
+  writeCalendarProperties(writer, obj->properties); // RFC 5545 puts the calendar's properties before its components
+
+  ListIterator eventIter = createIterator(obj->events);
+  Event* event;
+  while ((event = nextElement(&eventIter))) {
+    ICalErrorCode error = writeCalendarEvent(writer, event);
+    if (error != OK) {
+      return error;
+    }
+  }
+
+  endCalendar(writer);
+  return writer->failed ? WRITE_ERROR : OK;
+}
+
+ICalErrorCode finishCalendarWriter(CalendarWriter* writer) {
+  flushWriter(writer);
+  return writer->failed ? WRITE_ERROR : OK;
+}
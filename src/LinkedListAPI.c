@@ -14,6 +14,8 @@
 
 
 
+#include <pthread.h>
+#include <stdint.h>
 #include "LinkedListAPI.h"
 
 /** Function to initialize the list metadata head with the appropriate function pointers.
@@ -26,6 +28,506 @@ List initializeList(char* (*printFunction)(void *toBePrinted),void (*deleteFunct
   return (List) { .deleteData = deleteFunction, .compare = compareFunction, .printData = printFunction, .length = 0 };
 }
 
+/** Same as initializeList, but the nodes of the list come from the arena. Data that was not allocated from
+ * the arena is adopted by it when it is inserted, so freeing the arena deletes it too.
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeListInArena(Arena* arena, char* (*printFunction)(void *toBePrinted),void (*deleteFunction)(void *toBeDeleted),int (*compareFunction)(const void *first,const void *second)) {
+  List list = initializeList(printFunction, deleteFunction, compareFunction);
+  list.arena = arena;
+  return list;
+}
+
+/** Same as initializeList, but the elements are kept in one contiguous array that grows by doubling.
+ * Suits lists that are built once and iterated many times. Inserting into a vector or removing from it
+ * invalidates its iterators, so nothing can be deleted from it while it is being iterated. A copy of a vector
+ * List shares its array, and once either of them changes the other must not be used again. Lists are only
+ * vectors when their owner asks for one: none of the lists the calendar functions make are
+ *@return the list struct
+**/
+List initializeVectorList(char* (*printFunction)(void *toBePrinted),void (*deleteFunction)(void *toBeDeleted),int (*compareFunction)(const void *first,const void *second)) {
+  List list = initializeList(printFunction, deleteFunction, compareFunction);
+  list.storage = LIST_VECTOR;
+  return list;
+}
+
+/** Same as initializeVectorList, but the array comes from the arena and data is adopted like initializeListInArena
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeVectorListInArena(Arena* arena, char* (*printFunction)(void *toBePrinted),void (*deleteFunction)(void *toBeDeleted),int (*compareFunction)(const void *first,const void *second)) {
+  List list = initializeListInArena(arena, printFunction, deleteFunction, compareFunction);
+  list.storage = LIST_VECTOR;
+  return list;
+}
+
+/** Same as initializeList, but the list is always kept in the order of compareFunction by a skip list.
+ * Inserting, deleting and finding take O(log n) and every insert goes where insertSorted would put it
+ *@return the list struct
+**/
+List initializeSortedList(char* (*printFunction)(void *toBePrinted),void (*deleteFunction)(void *toBeDeleted),int (*compareFunction)(const void *first,const void *second)) {
+  List list = initializeList(printFunction, deleteFunction, compareFunction);
+  list.storage = LIST_SORTED;
+  return list;
+}
+
+/** Same as initializeSortedList, but the nodes come from the arena and data is adopted like initializeListInArena
+ *@return the list struct
+ *@param arena the arena the list lives in
+**/
+List initializeSortedListInArena(Arena* arena, char* (*printFunction)(void *toBePrinted),void (*deleteFunction)(void *toBeDeleted),int (*compareFunction)(const void *first,const void *second)) {
+  List list = initializeListInArena(arena, printFunction, deleteFunction, compareFunction);
+  list.storage = LIST_SORTED;
+  return list;
+}
+
+// Hands data that is going into an arena list to the arena, unless the arena allocated it
+static void adoptListData(List* list, void* data) {
+  if (list->arena && !arenaOwns(list->arena, data)) {
+    arenaAdopt(list->arena, data, list->deleteData); // The arena has to delete it when the calendar goes
+  }
+}
+
+// Takes data that is leaving an arena list back from the arena, if it was adopted
+static void releaseListData(List* list, void* data) {
+  if (list->arena && !arenaOwns(list->arena, data)) {
+    arenaRelease(list->arena, data);
+  }
+}
+
+// Deletes data that is leaving the list for good. Adopted data is taken back first so the arena does not delete it again
+static void deleteListData(List* list, void* data) {
+  releaseListData(list, data);
+  arenaDelete(list->arena, data, list->deleteData);
+}
+
+// Tells the list's index, if it has one, that data went in
+static void indexAdded(List* list, void* data) {
+  if (list->index) {
+    list->index->added(list->index, list, data);
+  }
+}
+
+// Tells the list's index, if it has one, that data is coming out
+static void indexRemoved(List* list, void* data) {
+  if (list->index) {
+    list->index->removed(list->index, data);
+  }
+}
+
+// Tells the list's index, if it has one, that everything is coming out
+static void indexCleared(List* list) {
+  if (list->index) {
+    list->index->cleared(list->index);
+  }
+}
+
+// Makes room in a vector for one more element. Returns 0 if it could not grow
+static int growVector(List* list) {
+  if (list->length < list->capacity) {
+    return 1;
+  }
+  int capacity = list->capacity ? list->capacity * 2 : 8; // Double it so inserting stays amortized O(1)
+  void** items;
+  if (list->arena) {
+    items = arenaAlloc(list->arena, sizeof(void*) * capacity); // The old array is left for freeArena
+    if (items && list->length) {
+      memcpy(items, list->items, sizeof(void*) * list->length);
+    }
+  } else {
+    items = realloc(list->items, sizeof(void*) * capacity);
+  }
+  if (!items) {
+    return 0;
+  }
+  list->items = items;
+  list->capacity = capacity;
+  return 1;
+}
+
+// Puts data into a vector at the index, sliding everything after it back
+static void insertVectorItem(List* list, int index, void* data) {
+  if (!data || !growVector(list)) {
+    return;
+  }
+  memmove(list->items + index + 1, list->items + index, sizeof(void*) * (list->length - index));
+  list->items[index] = data;
+  list->length ++;
+  adoptListData(list, data);
+  indexAdded(list, data);
+}
+
+// Takes the element at the index out of a vector, sliding everything after it forward, and returns it
+static void* removeVectorItem(List* list, int index) {
+  void* data = list->items[index];
+  indexRemoved(list, data);
+  memmove(list->items + index, list->items + index + 1, sizeof(void*) * (list->length - index - 1));
+  list->length --;
+  releaseListData(list, data);
+  return data;
+}
+
+// Lets go of the array of a vector and empties it
+static void freeVector(List* list) {
+  if (!list->arena) {
+    free(list->items);
+  }
+  list->items = NULL;
+  list->capacity = 0;
+  list->length = 0;
+}
+
+// Lists without an arena get their nodes from a pool that belongs to the thread. The pool carves nodes out of
+// slabs and keeps the ones that are freed for the next insert, so building and clearing lists does not hit malloc.
+// Slabs are aligned to their size so a node can find the pool it came from. A node freed on another thread goes
+// back to its own pool through a locked list, and a pool whose thread has gone is freed with its last node
+#define NODE_SLAB_BYTES 8192
+#define NODE_SLAB_SIZE ((NODE_SLAB_BYTES - 2 * sizeof(void*)) / sizeof(Node))
+
+typedef struct nodeSlab {
+  struct nodePool* pool;
+  struct nodeSlab* next;
+  Node nodes[NODE_SLAB_SIZE];
+} NodeSlab;
+
+_Static_assert(sizeof(NodeSlab) <= NODE_SLAB_BYTES, "a slab has to fit in its alignment");
+
+typedef struct nodePool {
+  NodeSlab* slabs; // Most recent first
+  size_t used; // Nodes handed out of the most recent slab
+  Node* recycled; // Freed nodes, chained through their next pointers
+  long live; // Nodes handed out and not given back yet
+
+  // Everything below is shared with other threads and guarded by the lock
+  pthread_mutex_t lock;
+  Node* remote; // Nodes freed on other threads
+  long remoteCount;
+  int orphaned; // Set once the thread is done with the pool. The last node to come back frees it
+} NodePool;
+
+static _Thread_local NodePool* nodePool;
+static pthread_key_t nodePoolKey;
+static pthread_once_t nodePoolKeyOnce = PTHREAD_ONCE_INIT;
+
+// Frees a pool and its slabs. Every node has to have come back
+static void destroyNodePool(NodePool* pool) {
+  NodeSlab* slab = pool->slabs;
+  while (slab) {
+    NodeSlab* next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+// Lets go of the pool of a thread. It goes now if all of its nodes are back, or when the last one is
+static void orphanNodePool(void* context) {
+  NodePool* pool = context;
+  pthread_mutex_lock(&pool->lock);
+  pool->live -= pool->remoteCount; // Only other threads touch live from here on, under the lock
+  pool->remote = NULL;
+  pool->remoteCount = 0;
+  pool->orphaned = 1;
+  int empty = pool->live == 0;
+  pthread_mutex_unlock(&pool->lock);
+  if (empty) {
+    destroyNodePool(pool);
+  }
+}
+
+// Lets go of a thread's pool when it exits. Nodes freed by destructors that run after this one take the locked path
+// back to it like any other thread's, and a node allocated by one starts a new pool that is let go of the same way
+static void exitNodePool(void* context) {
+  if (nodePool == context) {
+    nodePool = NULL;
+  }
+  orphanNodePool(context);
+}
+
+static void createNodePoolKey() {
+  pthread_key_create(&nodePoolKey, &exitNodePool);
+}
+
+// Returns the calling thread's pool, starting one if it has none
+static NodePool* threadNodePool() {
+  if (nodePool) {
+    return nodePool;
+  }
+  pthread_once(&nodePoolKeyOnce, &createNodePoolKey);
+  NodePool* pool = calloc(1, sizeof(NodePool));
+  if (!pool) {
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_setspecific(nodePoolKey, pool);
+  return nodePool = pool;
+}
+
+// Takes back the nodes that other threads freed. Returns 0 if there were none
+static int reclaimRemoteNodes(NodePool* pool) {
+  pthread_mutex_lock(&pool->lock);
+  Node* node = pool->remote;
+  pool->live -= pool->remoteCount;
+  pool->remote = NULL;
+  pool->remoteCount = 0;
+  pthread_mutex_unlock(&pool->lock);
+  pool->recycled = node;
+  return node != NULL;
+}
+
+// Takes a node from the pool, starting a new slab if there are none left
+static Node* allocPooledNode() {
+  NodePool* pool = threadNodePool();
+  if (!pool) {
+    return NULL;
+  }
+  Node* node = pool->recycled;
+  if (!node && (pool->slabs && pool->used == NODE_SLAB_SIZE) && reclaimRemoteNodes(pool)) {
+    node = pool->recycled;
+  }
+  if (node) {
+    pool->recycled = node->next;
+    pool->live ++;
+    return node;
+  }
+  if (!pool->slabs || pool->used == NODE_SLAB_SIZE) {
+    NodeSlab* slab = aligned_alloc(NODE_SLAB_BYTES, NODE_SLAB_BYTES);
+    if (!slab) {
+      return NULL;
+    }
+    slab->pool = pool;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->used = 0;
+  }
+  pool->live ++;
+  return &pool->slabs->nodes[pool->used ++];
+}
+
+// Gives a node back to the pool it came from
+static void recyclePooledNode(Node* node) {
+  NodePool* pool = ((NodeSlab*) ((uintptr_t) node & ~(uintptr_t) (NODE_SLAB_BYTES - 1)))->pool;
+  if (pool == nodePool) {
+    node->next = pool->recycled;
+    pool->recycled = node;
+    pool->live --;
+    return;
+  }
+  pthread_mutex_lock(&pool->lock);
+  int empty = 0;
+  if (pool->orphaned) {
+    empty = -- pool->live == 0;
+  } else {
+    node->next = pool->remote;
+    pool->remote = node;
+    pool->remoteCount ++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  if (empty) {
+    destroyNodePool(pool);
+  }
+}
+
+/** Lets go of the calling thread's node pool. Its slabs are freed once every node in them has been freed, on
+ * whichever thread that happens. Threads do this when they exit, so this is only needed to free the pool sooner
+ **/
+void freeNodePool() {
+  if (nodePool) {
+    pthread_setspecific(nodePoolKey, NULL);
+    NodePool* pool = nodePool;
+    nodePool = NULL;
+    orphanNodePool(pool);
+  }
+}
+
+// Makes a node for the list, out of its arena if it has one or the thread's pool otherwise
+static Node* newListNode(List* list, void* data) {
+  if (!data) {
+    return NULL;
+  }
+  Node* newNode = list->arena ? arenaAllocRecycled(list->arena, sizeof(Node)) : allocPooledNode();
+  if (!newNode) {
+    return NULL;
+  }
+  newNode->previous = NULL;
+  newNode->next = NULL;
+  newNode->data = data;
+  adoptListData(list, data); // The index is told once the node is linked in
+  return newNode;
+}
+
+// Frees a node that has been unlinked from the list. If its data was adopted by the arena, the caller gets it back
+static void freeListNode(List* list, Node* node) {
+  if (!list->arena) {
+    recyclePooledNode(node);
+    return;
+  }
+  releaseListData(list, node->data);
+  arenaRecycle(list->arena, node); // The next node can use it
+}
+
+// A sorted list is a skip list. Level 0 is an ordinary doubly linked list of Nodes, so head, tail and iterators work
+// the same as for a linked list. The higher levels skip ahead, each one over about SKIP_LIST_FANOUT times as many
+// nodes as the one below. The list's items hold where each level above 0 starts and capacity is the number of levels
+#define SKIP_LIST_MAX_LEVELS 16 // Plenty for 4^16 elements
+#define SKIP_LIST_FANOUT 4
+
+typedef struct skipNode {
+  Node node; // Level 0. Has to come first
+  int levels;
+  struct skipNode* forward[]; // Next node on levels 1 and up
+} SkipNode;
+
+static _Thread_local unsigned int skipListSeed = 2463534242u;
+
+// Picks how many levels a new node is on, 1 with probability 3/4, 2 with 3/16 and so on
+static int randomSkipLevels() {
+  skipListSeed ^= skipListSeed << 13; // xorshift32, good enough for coin flips
+  skipListSeed ^= skipListSeed >> 17;
+  skipListSeed ^= skipListSeed << 5;
+  int levels = 1;
+  unsigned int bits = skipListSeed;
+  while (levels < SKIP_LIST_MAX_LEVELS && bits % SKIP_LIST_FANOUT == 0) {
+    levels ++;
+    bits /= SKIP_LIST_FANOUT;
+  }
+  return levels;
+}
+
+// Returns the node after x on a level. NULL for x means the start of the list
+static SkipNode* skipNext(List* list, SkipNode* x, int level) {
+  if (level == 0) {
+    return (SkipNode*) (x ? x->node.next : list->head);
+  }
+  return x ? x->forward[level - 1] : (SkipNode*) list->items[level - 1];
+}
+
+static void setSkipNext(List* list, SkipNode* x, int level, SkipNode* next) {
+  if (level == 0) {
+    *(x ? &x->node.next : &list->head) = (Node*) next;
+  } else if (x) {
+    x->forward[level - 1] = next;
+  } else {
+    list->items[level - 1] = next;
+  }
+}
+
+// Fills before with the last node on each level that is less than data (NULL for the start of the list)
+static void findSkipPredecessors(List* list, const void* data, SkipNode* before[SKIP_LIST_MAX_LEVELS]) {
+  SkipNode* x = NULL;
+  for (int level = SKIP_LIST_MAX_LEVELS - 1; level >= 0; level--) {
+    SkipNode* next;
+    while (level < list->capacity && (next = skipNext(list, x, level)) && list->compare(data, next->node.data) > 0) {
+      x = next; // data is greater, keep going
+    }
+    before[level] = x; // Levels that are not in use yet start at the start of the list
+  }
+}
+
+// Puts data into a sorted list in front of the first element that it is less than or equal to
+static void insertSkipNode(List* list, void* data) {
+  if (!data) {
+    return;
+  }
+  if (!list->items) { // Where the levels start. Allocated once since it is small
+    list->items = arenaCalloc(list->arena, sizeof(void*) * (SKIP_LIST_MAX_LEVELS - 1));
+    if (!list->items) {
+      return;
+    }
+  }
+  int levels = randomSkipLevels();
+  SkipNode* newNode = arenaAlloc(list->arena, sizeof(SkipNode) + sizeof(SkipNode*) * (levels - 1));
+  if (!newNode) {
+    return;
+  }
+  SkipNode* before[SKIP_LIST_MAX_LEVELS];
+  findSkipPredecessors(list, data, before);
+  newNode->node.data = data;
+  newNode->levels = levels;
+  for (int level = 0; level < levels; level++) {
+    setSkipNext(list, newNode, level, skipNext(list, before[level], level));
+    setSkipNext(list, before[level], level, newNode);
+  }
+  if (levels > list->capacity) {
+    list->capacity = levels;
+  }
+  Node* next = newNode->node.next;
+  newNode->node.previous = (Node*) before[0];
+  *(next ? &next->previous : &list->tail) = &newNode->node;
+  list->length ++;
+  adoptListData(list, data);
+  indexAdded(list, data);
+}
+
+// Takes a node out of a sorted list, given the last node before it on each level, and returns its data
+static void* removeSkipNode(List* list, SkipNode* node, SkipNode* before[SKIP_LIST_MAX_LEVELS]) {
+  void* data = node->node.data;
+  indexRemoved(list, data);
+  for (int level = 0; level < node->levels; level++) {
+    setSkipNext(list, before[level], level, skipNext(list, node, level));
+  }
+  Node* next = node->node.next;
+  *(next ? &next->previous : &list->tail) = node->node.previous;
+  while (list->capacity > 1 && !list->items[list->capacity - 2]) {
+    list->capacity --; // The top level is empty now
+  }
+  list->length --;
+  releaseListData(list, data);
+  if (!list->arena) {
+    free(node);
+  }
+  return data;
+}
+
+// Finds the first element of a sorted list that compares equal to data, or NULL. Fills before for removeSkipNode
+static SkipNode* findSkipNode(List* list, const void* data, SkipNode* before[SKIP_LIST_MAX_LEVELS]) {
+  findSkipPredecessors(list, data, before);
+  SkipNode* x = skipNext(list, before[0], 0);
+  return x && list->compare(data, x->node.data) == 0 ? x : NULL;
+}
+
+// Finds the node holding exactly this data in a sorted list, or NULL. Fills before for removeSkipNode
+static SkipNode* findSkipNodeHolding(List* list, const void* data, SkipNode* before[SKIP_LIST_MAX_LEVELS]) {
+  SkipNode* x = findSkipNode(list, data, before);
+  while (x && x->node.data != data) { // Walk along the elements that compare equal to it
+    for (int level = 0; level < x->levels; level++) {
+      before[level] = x;
+    }
+    x = skipNext(list, x, 0);
+    if (x && list->compare(data, x->node.data) != 0) {
+      return NULL;
+    }
+  }
+  return x;
+}
+
+// Lets go of every node of a sorted list and empties it. Deletes the data too if deleteData is set
+static void freeSkipNodes(List* list, int deleteData) {
+  Node* currentNode = list->head;
+  while (currentNode != NULL) {
+    Node* next = currentNode->next;
+    if (deleteData) {
+      deleteListData(list, currentNode->data);
+    } else {
+      releaseListData(list, currentNode->data);
+    }
+    if (!list->arena) {
+      free(currentNode);
+    }
+    currentNode = next;
+  }
+  if (!list->arena) {
+    free(list->items);
+  }
+  list->items = NULL;
+  list->capacity = 0;
+  list->head = NULL;
+  list->tail = NULL;
+  list->length = 0;
+}
+
 /**Function for creating a node for the linked list.
 * This node contains abstracted (void *) data as well as previous and next
 * pointers to connect to other nodes in the list
@@ -66,7 +568,15 @@ void insertFront(List *list, void *toBeAdded) {
   if (!list) {
     return; // If the list is NULL dont do anything
   }
-  Node* newNode = initializeNode(toBeAdded);
+  if (list->storage == LIST_VECTOR) {
+    insertVectorItem(list, 0, toBeAdded);
+    return;
+  }
+  if (list->storage == LIST_SORTED) {
+    insertSkipNode(list, toBeAdded); // A sorted list only has one place for it
+    return;
+  }
+  Node* newNode = newListNode(list, toBeAdded);
   if (!newNode) {
     return; // If the new node is NULL then dont insert
   }
@@ -83,6 +593,7 @@ void insertFront(List *list, void *toBeAdded) {
     list->tail = newNode;
   }
   list->length ++;
+  indexAdded(list, toBeAdded);
 }
 
 /**Inserts a Node at the back of a linked list.
@@ -95,7 +606,15 @@ void insertBack(List *list, void *toBeAdded) {
   if (!list) {
     return; // If the list is NULL dont do anything
   }
-  Node* newNode = initializeNode(toBeAdded);
+  if (list->storage == LIST_VECTOR) {
+    insertVectorItem(list, list->length, toBeAdded);
+    return;
+  }
+  if (list->storage == LIST_SORTED) {
+    insertSkipNode(list, toBeAdded);
+    return;
+  }
+  Node* newNode = newListNode(list, toBeAdded);
   if (!newNode) {
     return; // If the new node is NULL then dont insert
   }
@@ -112,6 +631,7 @@ void insertBack(List *list, void *toBeAdded) {
     list->head = newNode;
   }
   list->length ++;
+  indexAdded(list, toBeAdded);
 }
 
 /**Returns a pointer to the data at the front of the list. Does not alter list structure.
@@ -120,6 +640,9 @@ void insertBack(List *list, void *toBeAdded) {
  *@return pointer to the data located at the head of the list
  **/
 void* getFromFront(List list) {
+  if (list.storage == LIST_VECTOR) {
+    return list.length ? list.items[0] : NULL;
+  }
   return ((list.head) != NULL) ? list.head->data : NULL; // If the list doesnt exist, return NULL
 }
 
@@ -129,9 +652,33 @@ void* getFromFront(List list) {
  *@return pointer to the data located at the tail of the list
  **/
 void* getFromBack(List list) {
+  if (list.storage == LIST_VECTOR) {
+    return list.length ? list.items[list.length - 1] : NULL;
+  }
   return ((list.tail) != NULL) ? list.tail->data : NULL; // If the list doesnt exist, return NULL
 }
 
+/**Returns a pointer to the data at a position in the list. Does not alter list structure.
+ * Constant time for a vector, a linked list is walked from the head
+ *@pre The list exists and has memory allocated to it
+ *@param the list struct
+ *@param position how many elements come before it
+ *@return pointer to the data at the position, or NULL if the list is not that long
+ **/
+void* getElementAt(List list, int position) {
+  if (position < 0) {
+    return NULL;
+  }
+  if (list.storage == LIST_VECTOR) {
+    return position < list.length ? list.items[position] : NULL;
+  }
+  Node* node = list.head;
+  while (node && position--) {
+    node = node->next;
+  }
+  return node ? node->data : NULL;
+}
+
 /** Clears the contents linked list, freeing all memory asspociated with these contents.
 * uses the supplied function pointer to release allocated memory for the data
 *@pre 'List' type must exist and be used in order to keep track of the linked list.
@@ -141,15 +688,61 @@ void clearList(List *list) {
   if (!list) {
     return; // If the list is NULL dont do anything
   }
+  indexCleared(list);
+  if (list->storage == LIST_VECTOR) {
+    for (int i = 0; i < list->length; i++) {
+      deleteListData(list, list->items[i]); //Release the contents unless the arena owns them
+    }
+    freeVector(list);
+    return;
+  }
+  if (list->storage == LIST_SORTED) {
+    freeSkipNodes(list, 1);
+    return;
+  }
   Node* currentNode = list->head;
   while (currentNode != NULL) {
-    list->deleteData(currentNode->data); //Release the contents of this node
+    deleteListData(list, currentNode->data); //Release the contents of this node unless the arena owns them
     Node* next = currentNode->next; //Store the node we will be moving to
-    free(currentNode); //Free this node
+    freeListNode(list, currentNode); //Free this node
     currentNode = next; //Move to the next node
     list->head = currentNode; //The new node is now the head of the list
   }
   list->tail = NULL; //List is empty so set the tail to NULL
+  list->length = 0;
+}
+
+/** Clears the nodes of the linked list without releasing the data they hold.
+* used when the data has been handed over to another list
+*@pre 'List' type must exist and be used in order to keep track of the linked list.
+*@post the list is empty and its data is untouched
+*@param list pointer to the List-type dummy node
+**/
+void clearListNodes(List *list) {
+  if (!list) {
+    return; // If the list is NULL dont do anything
+  }
+  indexCleared(list);
+  if (list->storage == LIST_VECTOR) {
+    for (int i = 0; i < list->length; i++) {
+      releaseListData(list, list->items[i]); // The data belongs to someone else now
+    }
+    freeVector(list);
+    return;
+  }
+  if (list->storage == LIST_SORTED) {
+    freeSkipNodes(list, 0);
+    return;
+  }
+  Node* currentNode = list->head;
+  while (currentNode != NULL) {
+    Node* next = currentNode->next; //Store the node we will be moving to
+    freeListNode(list, currentNode); //Free this node but not its data
+    currentNode = next; //Move to the next node
+  }
+  list->head = NULL;
+  list->tail = NULL;
+  list->length = 0;
 }
 
 /** Uses the comparison function pointer to place the element in the
@@ -165,6 +758,18 @@ void insertSorted(List *list, void *toBeAdded) {
   if (!list) {
     return; // If the list is NULL dont do anything
   }
+  if (list->storage == LIST_VECTOR) {
+    int index = 0;
+    while (index < list->length && list->compare(toBeAdded, list->items[index]) > 0) {
+      index ++; // Goes before the first element it is less than or equal to
+    }
+    insertVectorItem(list, index, toBeAdded);
+    return;
+  }
+  if (list->storage == LIST_SORTED) {
+    insertSkipNode(list, toBeAdded);
+    return;
+  }
   Node* currentNode = list->head; //Iterate over the nodes starting from the head
   if (!currentNode) {
     insertBack(list, toBeAdded);
@@ -175,7 +780,7 @@ void insertSorted(List *list, void *toBeAdded) {
     int compareValue = list->compare(toBeAdded, currentNode->data); //Compare toBeAdded with the value of this node
 
     if (compareValue <= 0) { //If the value is less than or equal to 0 toBeAdded should come before the current node
-      Node* newNode = initializeNode(toBeAdded);
+      Node* newNode = newListNode(list, toBeAdded);
       if (!newNode) {
         return; // If the new node is NULL then dont insert
       }
@@ -190,11 +795,12 @@ void insertSorted(List *list, void *toBeAdded) {
         list->head = newNode; // The new node will be the new head of the list
       }
       currentNode->previous = newNode; // The previous node of the current node will become the new node
+      list->length ++;
+      indexAdded(list, toBeAdded);
       break; // Node has been inserted so we can break out of the loop
     } else if (!nextNode) {
       // If the next node is NULL then we have reached the end of the list and can insert toBeAdded at the end of the list
-      insertBack(list, toBeAdded);
-      list->length ++;
+      insertBack(list, toBeAdded); // Counts it
     }
 
     currentNode = nextNode; //Move to the next node
@@ -214,11 +820,25 @@ void* deleteDataFromList(List *list, void *toBeDeleted) {
   if (!toBeDeleted) {
     return NULL;
   }
+  if (list->storage == LIST_VECTOR) {
+    for (int i = 0; i < list->length; i++) {
+      if (list->compare(toBeDeleted, list->items[i]) == 0) {
+        return removeVectorItem(list, i);
+      }
+    }
+    return NULL;
+  }
+  if (list->storage == LIST_SORTED) {
+    SkipNode* before[SKIP_LIST_MAX_LEVELS];
+    SkipNode* node = findSkipNode(list, toBeDeleted, before);
+    return node ? removeSkipNode(list, node, before) : NULL;
+  }
   Node* currentNode = list->head; //Iterate over the nodes starting from the head
   while (currentNode != NULL) {
     Node* nextNode = currentNode->next; //Store the next node incase the current node must be freed
     if (list->compare(toBeDeleted, currentNode->data) == 0) { // If the data at the current node equals toBeDeleted
       void* data = currentNode->data;
+      indexRemoved(list, data);
 
       Node* previousNode = currentNode->previous;
       if (nextNode) {
@@ -231,15 +851,104 @@ void* deleteDataFromList(List *list, void *toBeDeleted) {
       } else {
         list->head = nextNode; // If the previous node is NULL, the next node is the new list head
       }
-      free(currentNode); // Free this node
-      return data; // Return pointer to data
+      freeListNode(list, currentNode); // Free this node
       list->length --;
+      return data; // Return pointer to data
     }
     currentNode = nextNode; //Move to the next node
   }
   return NULL; // Return NULL if we have made it to the end of the list
 }
 
+/** Removes the node holding exactly this data from the list without comparing or freeing anything.
+ * changes pointer values of surrounding nodes to maintain list structure.
+ *@pre List must exist and have memory allocated to it
+ *@post the node is gone and the caller owns the data
+ *@param list pointer to the dummy head of the list
+ *@param toBeRemoved pointer to the data that is to be removed from the list
+ *@return on success: void * pointer to data  on failure: NULL
+ **/
+void* removeFromList(List *list, void *toBeRemoved) {
+  if (!list || !toBeRemoved) {
+    return NULL;
+  }
+  if (list->storage == LIST_VECTOR) {
+    for (int i = list->length - 1; i >= 0; i--) { // From the back, which is where removed elements usually are
+      if (list->items[i] == toBeRemoved) {
+        return removeVectorItem(list, i);
+      }
+    }
+    return NULL;
+  }
+  if (list->storage == LIST_SORTED) {
+    SkipNode* before[SKIP_LIST_MAX_LEVELS];
+    SkipNode* node = findSkipNodeHolding(list, toBeRemoved, before);
+    return node ? removeSkipNode(list, node, before) : NULL;
+  }
+  Node* currentNode = list->head; //Iterate over the nodes starting from the head
+  while (currentNode != NULL && currentNode->data != toBeRemoved) {
+    currentNode = currentNode->next; //Move to the next node
+  }
+  if (!currentNode) {
+    return NULL; // Return NULL if we have made it to the end of the list
+  }
+  indexRemoved(list, toBeRemoved);
+
+  Node* previousNode = currentNode->previous;
+  Node* nextNode = currentNode->next;
+  if (nextNode) {
+    nextNode->previous = previousNode; // The next node's new previous node is the current node's previous node
+  } else {
+    list->tail = previousNode; // If the next node is NULL, the previous node is the new list tail
+  }
+  if (previousNode) {
+    previousNode->next = nextNode; // The previous node's new next node is the current node's next node
+  } else {
+    list->head = nextNode; // If the previous node is NULL, the next node is the new list head
+  }
+  freeListNode(list, currentNode); // Free this node
+  list->length --;
+  return toBeRemoved; // Return pointer to data
+}
+
+/** Replaces the data at the back of the list, eg. when the last element had to be reallocated.
+ *@pre List must exist and have memory allocated to it
+ *@post the last element is toBeAdded. Nothing is freed. If the list is indexed the replaced data must still be valid
+ *@param list pointer to the dummy head of the list
+ *@param toBeAdded the new data for the back of the list
+ *@return on success: the data that was replaced  on failure (the list is empty): NULL
+ **/
+void* replaceBack(List* list, void* toBeAdded) {
+  if (!list || !toBeAdded) {
+    return NULL;
+  }
+  if (list->storage == LIST_SORTED) { // The new data goes wherever it sorts to
+    void* replaced = removeFromList(list, getFromBack(*list));
+    if (replaced) {
+      insertSkipNode(list, toBeAdded);
+    }
+    return replaced;
+  }
+  void** back;
+  if (list->storage == LIST_VECTOR) {
+    back = list->length ? &list->items[list->length - 1] : NULL;
+  } else {
+    back = list->tail ? &list->tail->data : NULL;
+  }
+  if (!back) {
+    return NULL; // Nothing to replace
+  }
+  void* replaced = *back;
+  if (replaced != toBeAdded) {
+    indexRemoved(list, replaced);
+    releaseListData(list, replaced);
+    adoptListData(list, toBeAdded);
+    *back = toBeAdded;
+    indexAdded(list, toBeAdded);
+  }
+  return replaced;
+}
+
 /**Returns a string that contains a string representation of
 the list traversed from  head to tail. Utilize the list's printData function pointer to create the string.
 returned string must be freed by the calling function.
@@ -248,40 +957,22 @@ returned string must be freed by the calling function.
  *@return on success: char * to string representation of list (must be freed after use).  on failure: NULL
  **/
 char* toString(List list) {
-  int numChars = strlen("HEAD<-->"); //Start keeping track of the number of chars that need to be allocated
+  StringBuilder string = initializeStringBuilder(0);
+  appendString(&string, "HEAD<-->"); //Start with the HEAD identifier
 
   ListIterator iter = createIterator(list); // Create an iterator to loop through the list
   void* element; // Variable to store the data
-
   while ((element = nextElement(&iter)) != NULL) {
     char* elementString = list.printData(element);
-    numChars += strlen(elementString); //Add the number of chars for the string representation of this data
     if (elementString) {
+      appendString(&string, elementString); //Append the string representation of this data
       free(elementString);
     }
-    numChars += strlen("<-->"); //Add the number of chars for the arrow symbol inbetween the nodes
-  }
-  numChars += strlen("TAIL"); //Allocate memory for the TAIL identifier
-
-  char* string = malloc(numChars*sizeof(char) + 1); //Allocate enough memory for all the chars
-  if (string == NULL) {
-    return NULL; // If the allocation failed return NULL
+    appendString(&string, "<-->"); //Append the link identifier
   }
+  appendString(&string, "TAIL"); //Append the TAIL identifier
 
-  strcpy(string, "HEAD<-->"); //Concatenate the HEAD identifier
-
-  iter = createIterator(list); // Make a new iterator to loop over the list again
-  while ((element = nextElement(&iter)) != NULL) {
-    char* elementString = list.printData(element);
-    strcat(string, elementString); //Concatenate the string representation of this data
-    if (elementString) {
-      free(elementString);
-    }
-    strcat(string, "<-->"); //Concatenate the link identifier
-  }
-  strcat(string, "TAIL"); //Concatenate the TAIL identifier
-
-  return string;
+  return finishString(&string); // NULL if it ran out of memory
 }
 
 /** Function for creating an iterator for the linked list.
@@ -293,6 +984,9 @@ char* toString(List list) {
  *@param list - a pointer to the list to iterate over.
 **/
 ListIterator createIterator(List list) {
+  if (list.storage == LIST_VECTOR) {
+    return (ListIterator) { .item = list.items, .end = list.items + list.length };
+  }
   return (ListIterator) { list.head };
 }
 
@@ -305,6 +999,9 @@ ListIterator createIterator(List list) {
 *@param iter - an iterator to a list.
 **/
 void* nextElement(ListIterator* iter) {
+  if (iter->item) { // Iterating a vector
+    return iter->item < iter->end ? *iter->item++ : NULL;
+  }
   Node* current  = iter->current;
   if (!current) {
     return NULL;
@@ -342,3 +1039,27 @@ void* findElement(List list, bool (*compare)(const void* first,const void* secon
   }
   return NULL; // No match
 }
+
+/** Function that finds the first element of the list that compares equal to search, using the list's compare function.
+ * O(log n) for a sorted list, other lists are searched from the front
+ *@pre List exists and is valid
+ *@post List remains unchanged.
+ *@return The first element that compares equal to search.  If there is none, return NULL.
+ *@param list - a list struct
+ *@param search - what to compare the elements with
+ **/
+void* findSorted(List list, const void* search) {
+  if (list.storage == LIST_SORTED) {
+    SkipNode* before[SKIP_LIST_MAX_LEVELS];
+    SkipNode* node = findSkipNode(&list, search, before);
+    return node ? node->node.data : NULL;
+  }
+  ListIterator iter = createIterator(list);
+  void* element;
+  while ((element = nextElement(&iter))) {
+    if (list.compare(search, element) == 0) {
+      return element;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,112 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file measures how fast lists can be filled and cleared
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE // For clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "LinkedListAPI.h"
+
+#define BENCHMARK_ELEMENTS 1000 // Elements per list, about the number of lines in a large calendar
+#define BENCHMARK_ROUNDS 2000 // Times each list is filled and cleared
+#define BENCHMARK_SORTED_ELEMENTS 20000 // Enough for insertSorted on a linked list to show that it is O(n^2)
+
+static int elements[BENCHMARK_ELEMENTS]; // The data does not matter, only the nodes
+static int sortedElements[BENCHMARK_SORTED_ELEMENTS]; // Random keys, like timestamps arriving out of order
+
+void deleteNothing(void* toBeDeleted) {
+}
+
+int compareNothing(const void* first, const void* second) {
+  return 0;
+}
+
+int compareInts(const void* first, const void* second) {
+  int a = *(const int*) first;
+  int b = *(const int*) second;
+  return (a > b) - (a < b);
+}
+
+char* printNothing(void* toBePrinted) {
+  return NULL;
+}
+
+double secondsSince(struct timespec start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Fills the list from the back and clears it again, over and over. Prints the time per element inserted and cleared
+void benchmarkInsertClear(char* description, List list) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int round = 0; round < BENCHMARK_ROUNDS; round ++) {
+    for (int i = 0; i < BENCHMARK_ELEMENTS; i ++) {
+      insertBack(&list, &elements[i]);
+    }
+    clearList(&list);
+  }
+  double seconds = secondsSince(start);
+  printf("%-30s %6.1f ns per insert+clear\n", description, seconds * 1e9 / ((double) BENCHMARK_ROUNDS * BENCHMARK_ELEMENTS));
+}
+
+// Keeps a list full and keeps taking elements out of the middle and putting new ones in, like a list that is being edited
+void benchmarkEdit(char* description, List list) {
+  for (int i = 0; i < BENCHMARK_ELEMENTS; i ++) {
+    insertBack(&list, &elements[i]);
+  }
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int round = 0; round < BENCHMARK_ROUNDS * 100; round ++) {
+    void* front = getFromFront(list);
+    removeFromList(&list, front);
+    insertBack(&list, front);
+  }
+  double seconds = secondsSince(start);
+  printf("%-30s %6.1f ns per remove+insert\n", description, seconds * 1e9 / (BENCHMARK_ROUNDS * 100.0));
+  clearList(&list);
+}
+
+// Builds a sorted list one insertSorted at a time, then finds and deletes every element by value
+void benchmarkSorted(char* description, List list) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < BENCHMARK_SORTED_ELEMENTS; i ++) {
+    insertSorted(&list, &sortedElements[i]);
+  }
+  double insertSeconds = secondsSince(start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < BENCHMARK_SORTED_ELEMENTS; i ++) {
+    deleteDataFromList(&list, &sortedElements[i]);
+  }
+  double deleteSeconds = secondsSince(start);
+  printf("%-30s %6.1f ns per insertSorted %6.1f ns per delete (%d left)\n", description, insertSeconds * 1e9 / BENCHMARK_SORTED_ELEMENTS,
+    deleteSeconds * 1e9 / BENCHMARK_SORTED_ELEMENTS, getLength(list));
+  clearList(&list);
+}
+
+int main(int argc, char const *argv[]) {
+  srand(2750);
+  for (int i = 0; i < BENCHMARK_SORTED_ELEMENTS; i ++) {
+    sortedElements[i] = rand();
+  }
+
+  benchmarkInsertClear("linked list", initializeList(&printNothing, &deleteNothing, &compareNothing));
+  benchmarkInsertClear("vector list", initializeVectorList(&printNothing, &deleteNothing, &compareNothing));
+
+  benchmarkEdit("linked list", initializeList(&printNothing, &deleteNothing, &compareNothing));
+
+  benchmarkSorted("linked list", initializeList(&printNothing, &deleteNothing, &compareInts));
+  benchmarkSorted("vector list", initializeVectorList(&printNothing, &deleteNothing, &compareInts));
+  benchmarkSorted("sorted list", initializeSortedList(&printNothing, &deleteNothing, &compareInts));
+  freeNodePool();
+  return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file measures how much memory a parsed calendar takes per event
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE // For mkstemps
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "CalendarParser.h"
+
+#define BENCHMARK_EVENTS 10000 // Enough events that the calendar itself does not matter
+// Bytes per event the last time the layout of the structs changed on purpose. Update it along with such a change.
+// A run with the default number of events fails if it uses more than BASELINE_TOLERANCE over this
+#define BASELINE_BYTES_PER_EVENT 1952.1
+#define BASELINE_TOLERANCE 0.01
+
+// Writes a calendar with the given number of typical events (a handful of properties and one alarm each) to the file
+void writeBenchmarkCalendar(FILE* file, int events) {
+  fprintf(file, "BEGIN:VCALENDAR\r\nVERSION:2.0\r\nPRODID:-//Memory Benchmark//EN\r\n");
+  for (int i = 0; i < events; i ++) {
+    fprintf(file, "BEGIN:VEVENT\r\n");
+    fprintf(file, "UID:%d-benchmark@example.com\r\n", i);
+    fprintf(file, "DTSTAMP:20171017T%02d%02d00Z\r\n", (i / 60) % 24, i % 60);
+    fprintf(file, "DTSTART:20171018T090000Z\r\n");
+    fprintf(file, "DTEND:20171018T100000Z\r\n");
+    fprintf(file, "SUMMARY:Meeting number %d\r\n", i);
+    fprintf(file, "LOCATION:Room %d\r\n", i % 100);
+    fprintf(file, "STATUS:CONFIRMED\r\n");
+    fprintf(file, "BEGIN:VALARM\r\nACTION:DISPLAY\r\nTRIGGER:-PT15M\r\nDESCRIPTION:Reminder\r\nEND:VALARM\r\n");
+    fprintf(file, "END:VEVENT\r\n");
+  }
+  fprintf(file, "END:VCALENDAR\r\n");
+}
+
+int main(int argc, char const *argv[]) {
+  int events = argc > 1 ? atoi(argv[1]) : BENCHMARK_EVENTS;
+  if (events < 1) {
+    printf("Usage: %s [number of events]\n", argv[0]);
+    return 1;
+  }
+
+  char fileName[] = "/tmp/memoryBenchmarkXXXXXX.ics";
+  int fd = mkstemps(fileName, 4); // Keep the .ics extension or the parser will not take it
+  FILE* file = fd < 0 ? NULL : fdopen(fd, "w");
+  if (!file) {
+    printf("Could not create %s\n", fileName);
+    return 1;
+  }
+  writeBenchmarkCalendar(file, events);
+  fclose(file);
+
+  Calendar* calendar = NULL;
+  ICalErrorCode error = createCalendar(fileName, &calendar);
+  unlink(fileName);
+  if (error != OK) {
+    printf("Could not parse the benchmark calendar: %s\n", printError(error));
+    deleteCalendar(calendar);
+    return 1;
+  }
+
+  size_t reserved = 0;
+  size_t used = arenaBytesUsed(calendar->arena, &reserved);
+  printf("sizeof(Calendar): %zu sizeof(Event): %zu sizeof(Alarm): %zu sizeof(Property): %zu\n", sizeof(Calendar), sizeof(Event), sizeof(Alarm), sizeof(Property));
+  printf("events: %d\n", getLength(calendar->events));
+  printf("bytes used: %zu (%.1f per event)\n", used, (double) used / events);
+  printf("bytes reserved: %zu (%.1f per event)\n", reserved, (double) reserved / events);
+
+  double perEvent = (double) used / events;
+  int regressed = events == BENCHMARK_EVENTS && perEvent > BASELINE_BYTES_PER_EVENT * (1 + BASELINE_TOLERANCE);
+  printf("baseline: %.1f per event (%+.1f%%)%s\n", BASELINE_BYTES_PER_EVENT, (perEvent / BASELINE_BYTES_PER_EVENT - 1) * 100,
+         regressed ? " REGRESSED" : "");
+
+  deleteCalendar(calendar);
+  return regressed;
+}
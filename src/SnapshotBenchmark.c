@@ -0,0 +1,119 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file measures how much faster a calendar loads from a snapshot than from its iCalendar file
+ * No code was used from previous classes/ sources
+ */
+
+#define _GNU_SOURCE // For clock_gettime and mkstemps
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CalendarParser.h"
+#include "CalendarWriter.h"
+#include "HelperFunctions.h"
+
+#define BENCHMARK_EVENTS 20000 // A large calendar, where startup time starts to hurt
+#define BENCHMARK_ROUNDS 5 // Loads of each kind. The fastest one is reported
+
+double secondsSince(struct timespec start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Streams a calendar with the given number of typical events to the file, one event at a time
+void writeBenchmarkCalendar(FILE* file, int events) {
+  CalendarWriter* writer = malloc(sizeof(CalendarWriter));
+  initializeFileWriter(writer, file);
+  beginCalendar(writer, "-//Snapshot Benchmark//EN", 2);
+  for (int i = 0; i < events; i ++) {
+    Event* event = newEmptyEvent();
+    char text[64];
+    sprintf(text, "%d-benchmark@example.com", i);
+    setEventUID(event, text);
+    sprintf(event->creationDateTime.date, "20171017");
+    sprintf(event->creationDateTime.time, "%02d%02d00", (i / 60) % 24, i % 60);
+    event->creationDateTime.UTC = true;
+    insertBack(&event->properties, createProperty("DTSTART", "20171018T090000Z"));
+    insertBack(&event->properties, createProperty("DTEND", "20171018T100000Z"));
+    sprintf(text, "Meeting number %d", i);
+    insertBack(&event->properties, createProperty("SUMMARY", text));
+    sprintf(text, "Room %d", i % 100);
+    insertBack(&event->properties, createProperty("LOCATION", text));
+    insertBack(&event->properties, createProperty("STATUS", "CONFIRMED"));
+    List alarmProps = initializeVectorList(&printPropertyListFunction, &deletePropertyListFunction, &comparePropertyListFunction);
+    insertBack(&alarmProps, createProperty("DESCRIPTION", "Reminder"));
+    insertBack(&event->alarms, createAlarm("DISPLAY", "-PT15M", alarmProps));
+    writeCalendarEvent(writer, event);
+    deleteEventListFunction(event);
+  }
+  endCalendar(writer);
+  finishCalendarWriter(writer);
+  free(writer);
+}
+
+// Loads the file over and over and returns the fastest time, or a negative time if it could not be loaded
+double timeLoad(ICalErrorCode (*load)(char* fileName, Calendar** obj), char* fileName) {
+  double fastest = -1;
+  for (int i = 0; i < BENCHMARK_ROUNDS; i ++) {
+    Calendar* calendar = NULL;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ICalErrorCode error = load(fileName, &calendar);
+    double seconds = secondsSince(start);
+    deleteCalendar(calendar);
+    if (error != OK) {
+      return -1;
+    }
+    if (fastest < 0 || seconds < fastest) {
+      fastest = seconds;
+    }
+  }
+  return fastest;
+}
+
+int main(int argc, char const *argv[]) {
+  int events = argc > 1 ? atoi(argv[1]) : BENCHMARK_EVENTS;
+  if (events < 1) {
+    printf("Usage: %s [number of events]\n", argv[0]);
+    return 1;
+  }
+
+  char fileName[] = "/tmp/snapshotBenchmarkXXXXXX.ics";
+  int fd = mkstemps(fileName, 4); // Keep the .ics extension or the parser will not take it
+  FILE* file = fd < 0 ? NULL : fdopen(fd, "w");
+  if (!file) {
+    printf("Could not create %s\n", fileName);
+    return 1;
+  }
+  writeBenchmarkCalendar(file, events);
+  fclose(file);
+
+  char snapshotName[sizeof(fileName) + 5];
+  sprintf(snapshotName, "%s.snap", fileName);
+  Calendar* calendar = NULL;
+  ICalErrorCode error = createCalendar(fileName, &calendar);
+  if (error == OK) {
+    error = writeCalendarSnapshot(snapshotName, calendar);
+  }
+  deleteCalendar(calendar);
+  if (error != OK) {
+    printf("Could not snapshot the benchmark calendar: %s\n", printError(error));
+    unlink(fileName);
+    return 1;
+  }
+
+  double parsed = timeLoad(&createCalendar, fileName);
+  double loaded = timeLoad(&createCalendarFromSnapshot, snapshotName);
+  unlink(fileName);
+  unlink(snapshotName);
+  printf("events: %d\n", events);
+  printf("createCalendar: %.1f ms\n", parsed * 1000);
+  printf("createCalendarFromSnapshot: %.1f ms (%.1fx faster)\n", loaded * 1000, parsed / loaded);
+  return 0;
+}
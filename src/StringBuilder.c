@@ -0,0 +1,106 @@
+/*
+ * CIS2750 F2017
+ * Assignment 2
+ * Jackson Zavarella 0929350
+ * This file contains the growable strings that everything is printed into
+ * No code was used from previous classes/ sources
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "StringBuilder.h"
+
+#define STRING_BUILDER_FIRST_CAPACITY 256 // Enough for a few lines
+
+StringBuilder initializeStringBuilder(size_t capacity) {
+  return (StringBuilder) { .capacity = capacity };
+}
+
+// Makes room for n more chars and the null terminator. Returns 0 if there is no memory
+static int reserveChars(StringBuilder* builder, size_t n) {
+  if (builder->failed) {
+    return 0;
+  }
+  size_t needed = builder->length + n + 1;
+  if (builder->string && needed <= builder->capacity) {
+    return 1;
+  }
+  size_t capacity = builder->capacity ? builder->capacity : STRING_BUILDER_FIRST_CAPACITY;
+  while (capacity < needed) {
+    capacity *= 2; // Double it so appending stays amortized O(1) per char
+  }
+  char* string = realloc(builder->string, capacity);
+  if (!string) {
+    builder->failed = 1;
+    return 0;
+  }
+  string[builder->length] = '\0'; // In case this is the first time
+  builder->string = string;
+  builder->capacity = capacity;
+  return 1;
+}
+
+void appendChars(StringBuilder* builder, const char* c, size_t n) {
+  if (!reserveChars(builder, n)) {
+    return;
+  }
+  memcpy(builder->string + builder->length, c, n);
+  builder->length += n;
+  builder->string[builder->length] = '\0';
+}
+
+void appendString(StringBuilder* builder, const char* c) {
+  appendChars(builder, c, strlen(c));
+}
+
+void appendStrings(StringBuilder* builder, const char* c, ...) {
+  va_list valist;
+  va_start(valist, c);
+  while (c) {
+    appendString(builder, c);
+    c = va_arg(valist, const char*); // Move to the next
+  }
+  va_end(valist);
+}
+
+void appendRepeated(StringBuilder* builder, char c, size_t n) {
+  if (!reserveChars(builder, n)) {
+    return;
+  }
+  memset(builder->string + builder->length, c, n);
+  builder->length += n;
+  builder->string[builder->length] = '\0';
+}
+
+void appendFormat(StringBuilder* builder, const char* format, ...) {
+  va_list valist;
+  va_start(valist, format);
+  int n = vsnprintf(NULL, 0, format, valist); // Measure it first
+  va_end(valist);
+  if (n < 0 || !reserveChars(builder, n)) {
+    return;
+  }
+  va_start(valist, format);
+  vsnprintf(builder->string + builder->length, n + 1, format, valist);
+  va_end(valist);
+  builder->length += n;
+}
+
+char* finishString(StringBuilder* builder) {
+  if (!builder->failed) {
+    reserveChars(builder, 0); // Nothing was appended, hand over an empty string
+  }
+  char* string = builder->failed ? NULL : builder->string;
+  if (!string) {
+    free(builder->string);
+  }
+  *builder = initializeStringBuilder(0);
+  return string;
+}
+
+void freeStringBuilder(StringBuilder* builder) {
+  free(builder->string);
+  *builder = initializeStringBuilder(0);
+}